@@ -0,0 +1,101 @@
+// Copyright (c) 2018 The Bitcoin Post-Quantum developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <txdb.h>
+#include <util.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+static const int BLOCK_INDEX_ENTRIES = 20000;
+
+// An in-memory block tree holding a chain of regtest headers with full size
+// solutions, as the node reads it at startup.
+static std::unique_ptr<CBlockTreeDB> MakeBlockTree(const Consensus::Params& params, bool fHeaderCheck)
+{
+    std::unique_ptr<CBlockTreeDB> blocktree(new CBlockTreeDB(1 << 20, true));
+
+    std::vector<uint256> hashes(BLOCK_INDEX_ENTRIES);
+    std::vector<CDiskBlockIndex> entries(BLOCK_INDEX_ENTRIES);
+    uint256 hashPrev;
+    for (int i = 0; i < BLOCK_INDEX_ENTRIES; i++) {
+        CDiskBlockIndex& entry = entries[i];
+        entry.nHeight = i;
+        entry.nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA;
+        entry.nTx = 1;
+        entry.nDataPos = i * 1000;
+        entry.nMajorVersion = CBlockHeader::BPQ_MAJOR_VERSION;
+        entry.nMinorVersion = 0x20000000;
+        entry.hashPrev = hashPrev;
+        entry.hashMerkleRoot = hashPrev;
+        entry.nTime = 1530000000 + i * 600;
+        entry.nBits = 0x207fffff;
+        entry.nSolution.assign(params.nSolutionSize, 0x5a);
+        while (!CheckProofOfWork(entry.GetBlockHash(), entry.nBits, i >= params.BPQHeight, params))
+            entry.nNonce = ArithToUint256(UintToArith256(entry.nNonce) + 1);
+
+        hashes[i] = entry.GetBlockHash();
+        entry.phashBlock = &hashes[i];
+        if (fHeaderCheck)
+            entry.nHeaderCheck = entry.ComputeHeaderCheck(hashes[i]);
+        hashPrev = hashes[i];
+    }
+    bool fWritten = blocktree->WriteBatchSync({}, 0, entries);
+    assert(fWritten);
+    return blocktree;
+}
+
+static void LoadBlockIndex(benchmark::State& state, int nThreads, bool fHeaderCheck)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::REGTEST);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    std::unique_ptr<CBlockTreeDB> blocktree = MakeBlockTree(params, fHeaderCheck);
+
+    while (state.KeepRunning()) {
+        std::map<uint256, std::unique_ptr<CBlockIndex> > mapIndex;
+        auto insertBlockIndex = [&mapIndex](const uint256& hash) -> CBlockIndex* {
+            if (hash.IsNull())
+                return nullptr;
+            auto it = mapIndex.find(hash);
+            if (it == mapIndex.end()) {
+                it = mapIndex.emplace(hash, std::unique_ptr<CBlockIndex>(new CBlockIndex())).first;
+                it->second->phashBlock = &it->first;
+            }
+            return it->second.get();
+        };
+        bool fLoaded = blocktree->LoadBlockIndexGuts(params, insertBlockIndex, nThreads);
+        assert(fLoaded);
+        assert(mapIndex.size() == BLOCK_INDEX_ENTRIES);
+    }
+}
+
+// Entries without a header check, one thread reads, decodes and hashes them.
+static void LoadBlockIndexSingle(benchmark::State& state)
+{
+    LoadBlockIndex(state, 1, false);
+}
+
+// Entries without a header check are decoded and hashed on one thread per core.
+static void LoadBlockIndexParallel(benchmark::State& state)
+{
+    LoadBlockIndex(state, std::max(GetNumCores(), 1), false);
+}
+
+// Entries with a header check are stored under their hash, nothing is hashed.
+static void LoadBlockIndexHeaderCheck(benchmark::State& state)
+{
+    LoadBlockIndex(state, 1, true);
+}
+
+BENCHMARK(LoadBlockIndexSingle, 2);
+BENCHMARK(LoadBlockIndexParallel, 2);
+BENCHMARK(LoadBlockIndexHeaderCheck, 2);
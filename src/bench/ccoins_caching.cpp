@@ -6,6 +6,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <wallet/crypter.h>
 
 #include <vector>
@@ -86,3 +87,66 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+// Cache sizes seen during initial block download, with a P2PKH output each.
+static const uint32_t COINS_MAP_ENTRIES = 2000000;
+
+static std::vector<COutPoint> MakeOutPoints(uint32_t nCount)
+{
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(nCount);
+    for (uint32_t i = 0; i < nCount; i++)
+        outpoints.emplace_back(rng.rand256(), i % 4);
+    return outpoints;
+}
+
+static void FillCoinsMap(CCoinsMap& map, const std::vector<COutPoint>& outpoints)
+{
+    CScript script = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0) << OP_EQUALVERIFY << OP_CHECKSIG;
+    for (const COutPoint& outpoint : outpoints) {
+        CCoinsMap::iterator it = map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(Coin(CTxOut(CENT, script), 1, false))).first;
+        it->second.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    }
+}
+
+static void CCoinsMapInsert(benchmark::State& state)
+{
+    const std::vector<COutPoint> outpoints = MakeOutPoints(COINS_MAP_ENTRIES);
+    while (state.KeepRunning()) {
+        CCoinsMap map;
+        FillCoinsMap(map, outpoints);
+        assert(map.size() == COINS_MAP_ENTRIES);
+    }
+}
+
+// Half of the lookups hit, half miss, as for the inputs and outputs of blocks.
+static void CCoinsMapLookup(benchmark::State& state)
+{
+    const std::vector<COutPoint> outpoints = MakeOutPoints(2 * COINS_MAP_ENTRIES);
+    CCoinsMap map;
+    FillCoinsMap(map, std::vector<COutPoint>(outpoints.begin(), outpoints.begin() + COINS_MAP_ENTRIES));
+    while (state.KeepRunning()) {
+        size_t nFound = 0;
+        for (const COutPoint& outpoint : outpoints)
+            nFound += map.count(outpoint);
+        assert(nFound == COINS_MAP_ENTRIES);
+    }
+}
+
+// Erasing every entry, the way a flush of the coins cache does.
+static void CCoinsMapInsertErase(benchmark::State& state)
+{
+    const std::vector<COutPoint> outpoints = MakeOutPoints(COINS_MAP_ENTRIES);
+    while (state.KeepRunning()) {
+        CCoinsMap map;
+        FillCoinsMap(map, outpoints);
+        for (CCoinsMap::iterator it = map.begin(); it != map.end();)
+            it = map.erase(it);
+        assert(map.empty());
+    }
+}
+
+BENCHMARK(CCoinsMapInsert, 2);
+BENCHMARK(CCoinsMapLookup, 2);
+BENCHMARK(CCoinsMapInsertErase, 2);
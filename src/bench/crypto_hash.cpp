@@ -52,6 +52,22 @@ static void SHA256_32b(benchmark::State& state)
     }
 }
 
+static void SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA256D64(in.data(), in.data(), 1024);
+    }
+}
+
+static void SHA256_32b_Multi_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(32 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA256Multi(in.data(), in.data(), 32, 1024);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -93,6 +109,8 @@ BENCHMARK(SHA256, 340);
 BENCHMARK(SHA512, 330);
 
 BENCHMARK(SHA256_32b, 4700 * 1000);
+BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256_32b_Multi_1024, 7400);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
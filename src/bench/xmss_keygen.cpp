@@ -0,0 +1,41 @@
+// Copyright (c) 2018 The Bitcoin Post-Quantum developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <key.h>
+#include <util.h>
+
+#include <algorithm>
+#include <vector>
+
+// Building one H10 key: 1024 WOTS+ leaves and the tree over them.
+static void XMSSKeyGenH10(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        CKey key;
+        key.MakeNewKey(CKeyType::XMSS_256_H10);
+        assert(key.IsValid());
+    }
+}
+
+// The same amount of work per iteration, but building a batch of keys with
+// one thread per core, as the wallet XMSS keypool does.
+static void XMSSKeyGenH10Batch(benchmark::State& state)
+{
+    const unsigned int nThreads = std::max(GetNumCores(), 1);
+    std::vector<CKey> keys(nThreads);
+    size_t nGenerated = nThreads;
+    while (state.KeepRunning()) {
+        if (nGenerated == keys.size()) {
+            CKey::MakeNewKeys(keys, CKeyType::XMSS_256_H10, nThreads);
+            nGenerated = 0;
+        }
+        assert(keys[nGenerated].IsValid());
+        ++nGenerated;
+    }
+}
+
+BENCHMARK(XMSSKeyGenH10, 10);
+BENCHMARK(XMSSKeyGenH10Batch, 10);
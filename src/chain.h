@@ -8,6 +8,7 @@
 #define BITCOIN_CHAIN_H
 
 #include <arith_uint256.h>
+#include <hash.h>
 #include <primitives/block.h>
 #include <pow.h>
 #include <tinyformat.h>
@@ -131,7 +132,7 @@ enum BlockStatus: uint32_t {
     BLOCK_VALID_HEADER       =    1,
 
     //! All parent headers found, difficulty matches, timestamp >= median previous, checkpoint. Implies all parents
-    //! are also at least TREE.
+    //! are also at least TREE. Also implies the Equihash solution committed to by the block hash was verified.
     BLOCK_VALID_TREE         =    2,
 
     /**
@@ -216,7 +217,9 @@ public:
     uint32_t nTime;
     uint32_t nBits;
     uint256  nNonce;
-    std::vector<unsigned char> nSolution;
+    //! The Equihash solution is not kept in memory; it is stored with the
+    //! CDiskBlockIndex record and fetched on demand with GetBlockHeader()
+    //! from validation.h.
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     int32_t nSequenceId;
@@ -247,7 +250,6 @@ public:
         nTime          = 0;
         nBits          = 0;
         nNonce         = uint256();
-        nSolution.clear();
     }
 
     CBlockIndex()
@@ -259,15 +261,14 @@ public:
     {
         SetNull();
 
-        nMajorVersion  = block.nMajorVersion;
-        nMinorVersion  = block.nMinorVersion;
-        hashMerkleRoot = block.hashMerkleRoot;
-        hashWitnessMerkleRoot = block.hashWitnessMerkleRoot;
+        nMajorVersion  = block.GetMajorVersion();
+        nMinorVersion  = block.GetMinorVersion();
+        hashMerkleRoot = block.GetHashMerkleRoot();
+        hashWitnessMerkleRoot = block.GetHashWitnessMerkleRoot();
 
-        nTime          = block.nTime;
-        nBits          = block.nBits;
-        nNonce         = block.nNonce;
-        nSolution      = block.nSolution;
+        nTime          = block.GetBlockTime();
+        nBits          = block.GetBits();
+        nNonce         = block.GetNonce();
     }
 
     CDiskBlockPos GetBlockPos() const {
@@ -288,20 +289,20 @@ public:
         return ret;
     }
 
-    CBlockHeader GetBlockHeader() const
+    //! Block header without its Equihash solution
+    CBlockHeader GetBlockHeaderWithoutSolution() const
     {
         CBlockHeader block;
-        block.nMajorVersion  = nMajorVersion;
-        block.nMinorVersion  = nMinorVersion;
+        block.SetMajorVersion(nMajorVersion);
+        block.SetMinorVersion(nMinorVersion);
         if (pprev)
-            block.hashPrevBlock = pprev->GetBlockHash();
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.hashWitnessMerkleRoot = hashWitnessMerkleRoot;
-
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
+            block.SetHashPrevBlock(pprev->GetBlockHash());
+        block.SetHashMerkleRoot(hashMerkleRoot);
+        block.SetHashWitnessMerkleRoot(hashWitnessMerkleRoot);
+
+        block.SetTime(nTime);
+        block.SetBits(nBits);
+        block.SetNonce(nNonce);
         return block;
     }
 
@@ -387,16 +388,37 @@ class CDiskBlockIndex : public CBlockIndex
 {
 public:
     uint256 hashPrev;
+    std::vector<unsigned char> nSolution;
+    //! Ties the header fields to the block hash the entry is stored under, so
+    //! the hash does not have to be computed again when loading (see
+    //! ComputeHeaderCheck). 0 for entries written before it was added.
+    uint64_t nHeaderCheck;
 
     CDiskBlockIndex() {
         hashPrev = uint256();
+        nHeaderCheck = 0;
     }
 
-    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
+    CDiskBlockIndex(const CBlockIndex* pindex, const std::vector<unsigned char>& solution) : CBlockIndex(*pindex), nSolution(solution) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        nHeaderCheck = ComputeHeaderCheck(pindex->GetBlockHash());
     }
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        NCONST_PTR(this)->SerializationOp(s, CSerActionSerialize());
+        if (nHeaderCheck != 0)
+            s << nHeaderCheck;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        SerializationOp(s, CSerActionUnserialize());
+        // Older entries end after the solution
+        nHeaderCheck = 0;
+        if (!s.empty())
+            s >> nHeaderCheck;
+    }
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
@@ -426,18 +448,39 @@ public:
         READWRITE(nSolution);
     }
 
+    /**
+     * A cheap checksum of the header fields and the given block hash. It does
+     * not prove anything about the hash, it only catches entries which do not
+     * belong to the key they are read from; GetBlockHash() and the proof of
+     * work are checked in the background after startup.
+     */
+    uint64_t ComputeHeaderCheck(const uint256& hash) const
+    {
+        uint64_t nCheck = CSipHasher(0, 0)
+            .Write(hash.begin(), hash.size())
+            .Write(hashPrev.begin(), hashPrev.size())
+            .Write(hashMerkleRoot.begin(), hashMerkleRoot.size())
+            .Write(hashWitnessMerkleRoot.begin(), hashWitnessMerkleRoot.size())
+            .Write(nNonce.begin(), nNonce.size())
+            .Write(((uint64_t)nMajorVersion << 32) | (uint32_t)nMinorVersion)
+            .Write(((uint64_t)nTime << 32) | nBits)
+            .Write(((uint64_t)(uint32_t)nHeight << 32) | nSolution.size())
+            .Finalize();
+        return nCheck != 0 ? nCheck : 1;
+    }
+
     uint256 GetBlockHash() const
     {
         CBlockHeader block;
-        block.nMajorVersion   = nMajorVersion;
-        block.nMinorVersion   = nMinorVersion;
-        block.hashPrevBlock   = hashPrev;
-        block.hashMerkleRoot  = hashMerkleRoot;
-        block.hashWitnessMerkleRoot = hashWitnessMerkleRoot;
-        block.nTime           = nTime;
-        block.nBits           = nBits;
-        block.nNonce          = nNonce;
-        block.nSolution       = nSolution;
+        block.SetMajorVersion(nMajorVersion);
+        block.SetMinorVersion(nMinorVersion);
+        block.SetHashPrevBlock(hashPrev);
+        block.SetHashMerkleRoot(hashMerkleRoot);
+        block.SetHashWitnessMerkleRoot(hashWitnessMerkleRoot);
+        block.SetTime(nTime);
+        block.SetBits(nBits);
+        block.SetNonce(nNonce);
+        block.SetSolution(nSolution);
         return block.GetHash();
     }
 
@@ -40,17 +40,17 @@ static CBlock CreateGenesisBlock(const char* pszTimestamp, const CScript& genesi
     txNew.vout[0].scriptPubKey = genesisOutputScript;
     
     CBlock genesis;
-    genesis.nTime    = nTime;
-    genesis.nBits    = nBits;
-    genesis.nNonce   = ArithToUint256(arith_uint256(nNonce));
-    genesis.nMajorVersion = 0;
-    genesis.nMinorVersion = nVersion;
+    genesis.SetTime(nTime);
+    genesis.SetBits(nBits);
+    genesis.SetNonce(ArithToUint256(arith_uint256(nNonce)));
+    genesis.SetMajorVersion(0);
+    genesis.SetMinorVersion(nVersion);
     genesis.vtx.push_back(MakeTransactionRef(std::move(txNew)));
-    genesis.hashPrevBlock.SetNull();
-    genesis.hashMerkleRoot = BlockMerkleRoot(genesis);
-    genesis.hashWitnessMerkleRoot.SetNull();
+    genesis.SetHashPrevBlock(uint256());
+    genesis.SetHashMerkleRoot(BlockMerkleRoot(genesis));
+    genesis.SetHashWitnessMerkleRoot(uint256());
 
-    genesis.nSolution.resize(nSolSize);
+    genesis.SetSolution(std::vector<unsigned char>(nSolSize));
     return genesis;
 }
 
@@ -154,7 +154,7 @@ public:
         genesis = CreateGenesisBlock(1231006505, 2083236893, 0x1d00ffff, 1, 50 * COIN, consensus.nSolutionSize);
         consensus.hashGenesisBlock = genesis.GetHash();
         assert(consensus.hashGenesisBlock == uint256S("0x000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f"));
-        assert(genesis.hashMerkleRoot == uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"));
+        assert(genesis.GetHashMerkleRoot() == uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"));
         
         // Note that of those which support the service bits prefix, most only support a subset of
         // possible options.
@@ -285,7 +285,7 @@ public:
         genesis = CreateGenesisBlock(1296688602, 414098458, 0x1d00ffff, 1, 50 * COIN, consensus.nSolutionSize);
         consensus.hashGenesisBlock = genesis.GetHash();
         assert(consensus.hashGenesisBlock == uint256S("0x000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943"));
-        assert(genesis.hashMerkleRoot == uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"));
+        assert(genesis.GetHashMerkleRoot() == uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"));
 
         vSeeds.clear();        
         vSeeds.emplace_back("dnsseed.testnet.bitcoinpq.org");
@@ -410,7 +410,7 @@ public:
         genesis = CreateGenesisBlock(1296688602, 2, 0x207fffff, 1, 50 * COIN, consensus.nSolutionSize);
         consensus.hashGenesisBlock = genesis.GetHash();
         assert(consensus.hashGenesisBlock == uint256S("0x0f9188f13cb7b2c71f2a335e3a4fc328bf5beb436012afca590b1a11466e2206"));
-        assert(genesis.hashMerkleRoot == uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"));
+        assert(genesis.GetHashMerkleRoot() == uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"));
         
         vFixedSeeds.clear(); //!< Regtest mode doesn't have any fixed seeds.
         vSeeds.clear();      //!< Regtest mode doesn't have any DNS seeds.
@@ -31,18 +31,31 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0), pendingCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage + pendingCoinsUsage;
+}
+
+bool CCoinsViewCache::GetBaseCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (pendingCoins) {
+        CCoinsMap::const_iterator it = pendingCoins->find(outpoint);
+        if (it != pendingCoins->end()) {
+            coin = it->second.coin;
+            return !coin.IsSpent();
+        }
+    }
+    return base->GetCoin(outpoint, coin);
 }
 
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        it->second.used = true;
         return it;
+    }
     Coin tmp;
-    if (!base->GetCoin(outpoint, tmp))
+    if (!GetBaseCoin(outpoint, tmp))
         return cacheCoins.end();
     CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
     if (ret->second.coin.IsSpent()) {
@@ -50,6 +63,7 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
         // version as fresh.
         ret->second.flags = CCoinsCacheEntry::FRESH;
     }
+    ret->second.used = true;
     cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
     return ret;
 }
@@ -81,6 +95,7 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     }
     it->second.coin = std::move(coin);
     it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
+    it->second.used = true;
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
 }
 
@@ -106,6 +121,7 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
         cacheCoins.erase(it);
     } else {
         it->second.flags |= CCoinsCacheEntry::DIRTY;
+        it->second.used = true;
         it->second.coin.Clear();
     }
     return true;
@@ -201,12 +217,21 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 }
 
 bool CCoinsViewCache::Flush() {
+    // The base may not have all of an unfinished write back yet
+    assert(!pendingCoins);
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
-    cacheCoins.clear();
+    // Clearing would keep the pool at its peak size
+    ReallocateCache(CCoinsMap());
     cachedCoinsUsage = 0;
     return fOk;
 }
 
+void CCoinsViewCache::ReallocateCache(CCoinsMap&& mapNew) {
+    // SaltedOutpointHasher cannot be assigned, so the map is rebuilt in place.
+    cacheCoins.~CCoinsMap();
+    ::new (&cacheCoins) CCoinsMap(std::move(mapNew));
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -216,6 +241,91 @@ void CCoinsViewCache::Uncache(const COutPoint& hash)
     }
 }
 
+std::shared_ptr<const CCoinsMap> CCoinsViewCache::StartWriteBack() {
+    assert(!pendingCoins);
+    std::shared_ptr<CCoinsMap> mapDirty = std::make_shared<CCoinsMap>();
+    size_t nDirtyUsage = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+            continue;
+        }
+        if (it->second.coin.IsSpent()) {
+            // Spent entries are only kept in the write back, unless the base
+            // never had them at all.
+            if (!(it->second.flags & CCoinsCacheEntry::FRESH)) {
+                CCoinsCacheEntry& entry = (*mapDirty)[it->first];
+                entry.flags = CCoinsCacheEntry::DIRTY;
+            }
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            it = cacheCoins.erase(it);
+            continue;
+        }
+        CCoinsCacheEntry& entry = (*mapDirty)[it->first];
+        entry.coin = it->second.coin;
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        nDirtyUsage += entry.coin.DynamicMemoryUsage();
+        it->second.flags = 0;
+        ++it;
+    }
+    pendingCoinsUsage = memusage::DynamicUsage(*mapDirty) + nDirtyUsage;
+    pendingCoins = mapDirty;
+    return pendingCoins;
+}
+
+void CCoinsViewCache::EndWriteBack() {
+    pendingCoins.reset();
+    pendingCoinsUsage = 0;
+}
+
+void CCoinsViewCache::CancelWriteBack() {
+    assert(pendingCoins);
+    for (const auto& entry : *pendingCoins) {
+        CCoinsMap::iterator it = cacheCoins.find(entry.first);
+        if (it == cacheCoins.end()) {
+            // spent coins were only kept in the write back
+            it = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(entry.first), std::forward_as_tuple(Coin(entry.second.coin))).first;
+            cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+        }
+        it->second.flags |= CCoinsCacheEntry::DIRTY;
+    }
+    EndWriteBack();
+}
+
+size_t CCoinsViewCache::EntriesMemoryUsage() const {
+    return cacheCoins.get_allocator().resource().UsedBytes() + memusage::MallocUsage(sizeof(void*) * cacheCoins.bucket_count()) + cachedCoinsUsage;
+}
+
+void CCoinsViewCache::EvictClean(size_t nTargetUsage) {
+    for (int nPass = 0; nPass < 2 && EntriesMemoryUsage() > nTargetUsage; nPass++) {
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end() && EntriesMemoryUsage() > nTargetUsage;) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+                ++it;
+            } else if (it->second.used) {
+                it->second.used = false;
+                ++it;
+            } else {
+                cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+                it = cacheCoins.erase(it);
+            }
+        }
+    }
+    // Freed blocks are reused by the next entries. Only release them when
+    // too many are left over, by moving the remaining entries to a map with
+    // a pool of their own.
+    const CCoinsMapAllocator::ResourceType& resource = cacheCoins.get_allocator().resource();
+    if (resource.FreeBytes() * 100 <= resource.ChunkBytes() * COINS_CACHE_COMPACT_PERCENT)
+        return;
+    CCoinsMap mapNew;
+    mapNew.reserve(cacheCoins.size());
+    cachedCoinsUsage = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); ++it) {
+        CCoinsCacheEntry& entry = mapNew.emplace(it->first, std::move(it->second)).first->second;
+        cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
+    }
+    ReallocateCache(std::move(mapNew));
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
@@ -12,11 +12,14 @@
 #include <hash.h>
 #include <memusage.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
 /**
@@ -104,6 +107,7 @@ struct CCoinsCacheEntry
 {
     Coin coin; // The actual cached data.
     unsigned char flags;
+    bool used; // Looked up, added or spent since the last CCoinsViewCache::EvictClean pass.
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
@@ -115,11 +119,21 @@ struct CCoinsCacheEntry
          */
     };
 
-    CCoinsCacheEntry() : flags(0) {}
-    explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
+    CCoinsCacheEntry() : flags(0), used(false) {}
+    explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0), used(false) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * Cache entries are allocated from a pool of their own per map, which saves
+ * the malloc overhead of an allocation per entry. The largest pooled block
+ * fits a std::unordered_map node: the entry, a next pointer and a cached hash.
+ */
+typedef std::pair<const COutPoint, CCoinsCacheEntry> CCoinsMapValue;
+//! Share of the coins map pool which may be left free by evicted entries before it is compacted
+static const size_t COINS_CACHE_COMPACT_PERCENT = 25;
+static const size_t COINS_MAP_POOL_BLOCK_SIZE = (sizeof(CCoinsMapValue) + 2 * sizeof(void*) + alignof(void*) - 1) / alignof(void*) * alignof(void*);
+typedef PoolAllocator<CCoinsMapValue, COINS_MAP_POOL_BLOCK_SIZE> CCoinsMapAllocator;
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -211,6 +225,10 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Modifications taken by StartWriteBack which may not be in the base yet. */
+    std::shared_ptr<const CCoinsMap> pendingCoins;
+    size_t pendingCoinsUsage;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -274,6 +292,35 @@ public:
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Start writing the modifications to the base without emptying the cache.
+     * The dirty entries are copied into the returned map, which the caller
+     * writes to the base (together with GetBestBlock()), and are then clean in
+     * this cache. Until EndWriteBack is called, after that write completed,
+     * lookups which miss this cache are answered from the returned map, so
+     * clean entries can be evicted meanwhile.
+     */
+    std::shared_ptr<const CCoinsMap> StartWriteBack();
+    void EndWriteBack();
+    //! Give the entries of a write back which was not written back to the
+    //! cache, as modified. No other changes may be made since StartWriteBack.
+    void CancelWriteBack();
+    bool HaveWriteBack() const { return pendingCoins != nullptr; }
+    //! The part of DynamicMemoryUsage() held by the write back until it ends
+    size_t WriteBackMemoryUsage() const { return pendingCoinsUsage; }
+
+    /**
+     * Drop clean entries until the cache uses at most nTargetUsage bytes, not
+     * counting the write back. Entries used since the previous pass are kept
+     * once more (second chance). Dropped entries leave their blocks in the
+     * pool for the next ones; only once more than COINS_CACHE_COMPACT_PERCENT
+     * of the pool is left free are the remaining entries moved to a fresh map.
+     */
+    void EvictClean(size_t nTargetUsage);
+    //! The part of DynamicMemoryUsage() taken by the entries, without the
+    //! pool memory left free by erased ones and without the write back
+    size_t EntriesMemoryUsage() const;
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
@@ -295,6 +342,9 @@ public:
 
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
+    bool GetBaseCoin(const COutPoint &outpoint, Coin &coin) const;
+    //! Replace cacheCoins by mapNew, releasing the pool of the old map.
+    void ReallocateCache(CCoinsMap&& mapNew);
 };
 
 //! Utility function to add all of a transaction's outputs to a cache.
@@ -108,7 +108,12 @@ void xmss_set_leaf_index( uint8_t * privkey, size_t size, uint64_t leaf_index)
 
 bool xmss_create_dummy_der_signature(std::vector<unsigned char>& vchSig)
 {
-	vchSig = xmss_create_dummy_signature(DEFAULT_KEYTYPE);
+	return xmss_create_dummy_der_signature(vchSig, DEFAULT_KEYTYPE);
+}
+
+bool xmss_create_dummy_der_signature(std::vector<unsigned char>& vchSig, bpqcrypto::KeyType keytype)
+{
+	vchSig = xmss_create_dummy_signature(keytype);
 	vchSig.push_back(1);  // SIGHASH_ALL
 	return true;
 }
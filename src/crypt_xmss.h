@@ -106,6 +106,9 @@ inline bool xmss_is_der_pubkey(std::vector<uint8_t> const & pubkey) noexcept
 // Create a dummy signature that is a valid DER-encoding, +1 byte sighash
 bool xmss_create_dummy_der_signature(std::vector<unsigned char>& vchSig);
 
+// Same, with the exact size of a signature made by a key of the given type
+bool xmss_create_dummy_der_signature(std::vector<unsigned char>& vchSig, bpqcrypto::KeyType keytype);
+
 // der signature
 int64_t xmss_get_use_count_from_der_sig(std::vector<uint8_t> const & der_sig) noexcept;
 
@@ -7,6 +7,7 @@
 
 #include <assert.h>
 #include <string.h>
+#include <algorithm>
 #include <atomic>
 
 #if defined(__x86_64__) || defined(__amd64__)
@@ -19,6 +20,21 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 #endif
 #endif
 
+namespace sha256_sse41
+{
+void Transform_4way(uint32_t* s, const unsigned char* const* chunks);
+}
+
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* const* chunks);
+}
+
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+
 // Internal implementation code.
 namespace
 {
@@ -144,6 +160,7 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
 } // namespace sha256
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 bool SelfTest(TransformType tr) {
     static const unsigned char in1[65] = {0, 0x80};
@@ -172,23 +189,131 @@ bool SelfTest(TransformType tr) {
     return true;
 }
 
+/** Check a multi-way transform against the single-message one, lane by lane. */
+bool SelfTestMulti(TransformMultiType tr, size_t ways)
+{
+    uint32_t expected[8 * 8];
+    uint32_t state[8 * 8];
+    unsigned char data[8][64];
+    const unsigned char* chunks[8];
+    for (size_t lane = 0; lane < ways; ++lane) {
+        for (int i = 0; i < 64; ++i) {
+            data[lane][i] = (unsigned char)(lane * 64 + i);
+        }
+        chunks[lane] = data[lane];
+        sha256::Initialize(expected + 8 * lane);
+        expected[8 * lane] += lane; // distinct state per lane
+        memcpy(state + 8 * lane, expected + 8 * lane, 32);
+        sha256::Transform(expected + 8 * lane, data[lane], 1);
+    }
+    tr(state, chunks);
+    return memcmp(state, expected, 32 * ways) == 0;
+}
+
 TransformType Transform = sha256::Transform;
+TransformMultiType Transform4Way = nullptr;
+TransformMultiType Transform8Way = nullptr;
+
+/**
+ * Hash `lanes` messages of `size` bytes each with one multi-way transform
+ * call per block. All input is read before any output is written, so out
+ * may alias in.
+ */
+void HashLanes(unsigned char* out, const unsigned char* in, size_t size, size_t lanes, size_t ways, TransformMultiType tr)
+{
+    uint32_t s[8 * 8];
+    unsigned char tail[8][128];
+    const unsigned char* chunks[8];
+    const size_t full = size / 64;
+    const size_t rest = size % 64;
+    const size_t tailblocks = rest + 9 > 64 ? 2 : 1;
+
+    for (size_t lane = 0; lane < ways; ++lane) {
+        sha256::Initialize(s + 8 * lane);
+    }
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        memset(tail[lane], 0, sizeof(tail[lane]));
+        memcpy(tail[lane], in + lane * size + full * 64, rest);
+        tail[lane][rest] = 0x80;
+        WriteBE64(tail[lane] + tailblocks * 64 - 8, (uint64_t)size << 3);
+    }
+    for (size_t block = 0; block < full + tailblocks; ++block) {
+        for (size_t lane = 0; lane < ways; ++lane) {
+            if (lane >= lanes) {
+                // Unused lanes just repeat the first one.
+                chunks[lane] = chunks[0];
+            } else if (block < full) {
+                chunks[lane] = in + lane * size + block * 64;
+            } else {
+                chunks[lane] = tail[lane] + (block - full) * 64;
+            }
+        }
+        tr(s, chunks);
+    }
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        for (int i = 0; i < 8; ++i) {
+            WriteBE32(out + lane * 32 + 4 * i, s[8 * lane + i]);
+        }
+    }
+}
 
 } // namespace
 
 std::string SHA256AutoDetect()
 {
+    std::string ret = "standard";
 #if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__))
     uint32_t eax, ebx, ecx, edx;
-    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx >> 19) & 1) {
+    bool have_sse4 = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool have_shani = false;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        have_sse4 = (ecx >> 19) & 1;
+        // AVX needs OS support for saving the ymm registers (OSXSAVE and XCR0).
+        if (((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+            uint32_t xcr0_lo, xcr0_hi;
+            __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            have_avx = (xcr0_lo & 6) == 6;
+        }
+    }
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = have_avx && ((ebx >> 5) & 1);
+        have_shani = (ebx >> 29) & 1;
+    }
+    // Depending on the build options some of these may go unused.
+    (void)have_avx2;
+    (void)have_shani;
+
+#if defined(ENABLE_SHANI)
+    if (have_shani && have_sse4) {
+        Transform = sha256_shani::Transform;
+        ret = "shani(1way)";
+    } else
+#endif
+    if (have_sse4) {
         Transform = sha256_sse4::Transform;
-        assert(SelfTest(Transform));
-        return "sse4";
+        ret = "sse4(1way)";
+    }
+#if defined(ENABLE_SSE41)
+    if (have_sse4) {
+        Transform4Way = sha256_sse41::Transform_4way;
+        ret += ",sse41(4way)";
     }
+#endif
+#if defined(ENABLE_AVX2)
+    if (have_avx2) {
+        Transform8Way = sha256_avx2::Transform_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
 #endif
 
     assert(SelfTest(Transform));
-    return "standard";
+    assert(!Transform4Way || SelfTestMulti(Transform4Way, 4));
+    assert(!Transform8Way || SelfTestMulti(Transform8Way, 8));
+    return ret;
 }
 
 ////// SHA-256
@@ -247,3 +372,46 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+void SHA256Multi(unsigned char* output, const unsigned char* input, size_t size, size_t count)
+{
+    if (Transform8Way) {
+        while (count >= 8) {
+            HashLanes(output, input, size, 8, 8, Transform8Way);
+            output += 32 * 8;
+            input += size * 8;
+            count -= 8;
+        }
+    }
+    if (Transform4Way) {
+        while (count >= 4) {
+            HashLanes(output, input, size, 4, 4, Transform4Way);
+            output += 32 * 4;
+            input += size * 4;
+            count -= 4;
+        }
+    }
+    while (count) {
+        unsigned char hash[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(input, size).Finalize(hash);
+        memcpy(output, hash, sizeof(hash));
+        output += 32;
+        input += size;
+        count -= 1;
+    }
+}
+
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks)
+{
+    // Hash in groups of up to 8 through a scratch buffer, so that output may
+    // alias input (as it does when computing merkle trees in place).
+    unsigned char tmp[8 * 32];
+    while (blocks) {
+        size_t n = std::min<size_t>(blocks, 8);
+        SHA256Multi(tmp, input, 64, n);
+        SHA256Multi(output, tmp, 32, n);
+        output += 32 * n;
+        input += 64 * n;
+        blocks -= n;
+    }
+}
@@ -31,4 +31,20 @@ public:
  */
 std::string SHA256AutoDetect();
 
+/** Compute the SHA256 of many short messages of equal length.
+ *  output: pointer to a count*32 byte output buffer
+ *  input:  pointer to count messages of size bytes each, back to back
+ *  Uses the 4-way and 8-way multi-buffer transforms when available. All of a
+ *  group's input is read before its output is written, so hashing in place
+ *  (output == input, size >= 32) is allowed.
+ */
+void SHA256Multi(unsigned char* output, const unsigned char* input, size_t size, size_t count);
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -0,0 +1,114 @@
+// Copyright (c) 2018 The Bitcoin Post-Quantum developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// This is a 8-way AVX2 multi-buffer SHA-256 transform: it processes one
+// 64-byte block of eight independent messages at once, one per 32-bit lane.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+
+namespace sha256_avx2 {
+namespace {
+
+static const uint32_t K[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul,
+};
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z) { return Add(Add(x, y), z); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z, __m256i w) { return Add(Add(x, y), Add(z, w)); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z, __m256i w, __m256i v) { return Add(Add(x, y, z), Add(w, v)); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z) { return Xor(Xor(x, y), z); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__m256i inline ShR(__m256i x, int n) { return _mm256_srli_epi32(x, n); }
+__m256i inline ShL(__m256i x, int n) { return _mm256_slli_epi32(x, n); }
+
+__m256i inline Ch(__m256i x, __m256i y, __m256i z) { return Xor(z, And(x, Xor(y, z))); }
+__m256i inline Maj(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m256i inline Sigma0(__m256i x) { return Xor(Or(ShR(x, 2), ShL(x, 30)), Or(ShR(x, 13), ShL(x, 19)), Or(ShR(x, 22), ShL(x, 10))); }
+__m256i inline Sigma1(__m256i x) { return Xor(Or(ShR(x, 6), ShL(x, 26)), Or(ShR(x, 11), ShL(x, 21)), Or(ShR(x, 25), ShL(x, 7))); }
+__m256i inline sigma0(__m256i x) { return Xor(Or(ShR(x, 7), ShL(x, 25)), Or(ShR(x, 18), ShL(x, 14)), ShR(x, 3)); }
+__m256i inline sigma1(__m256i x) { return Xor(Or(ShR(x, 17), ShL(x, 15)), Or(ShR(x, 19), ShL(x, 13)), ShR(x, 10)); }
+
+/** Load big-endian word i of each lane's block. */
+__m256i inline Read8(const unsigned char* const* chunks, int i)
+{
+    return _mm256_set_epi32(ReadBE32(chunks[7] + 4 * i), ReadBE32(chunks[6] + 4 * i), ReadBE32(chunks[5] + 4 * i), ReadBE32(chunks[4] + 4 * i),
+                            ReadBE32(chunks[3] + 4 * i), ReadBE32(chunks[2] + 4 * i), ReadBE32(chunks[1] + 4 * i), ReadBE32(chunks[0] + 4 * i));
+}
+
+/** Load state word i of each lane. */
+__m256i inline Load8(const uint32_t* s, int i)
+{
+    return _mm256_set_epi32(s[56 + i], s[48 + i], s[40 + i], s[32 + i], s[24 + i], s[16 + i], s[8 + i], s[i]);
+}
+
+/** Store state word i of each lane. */
+void inline Store8(uint32_t* s, int i, __m256i v)
+{
+    uint32_t words[8];
+    _mm256_storeu_si256((__m256i*)words, v);
+    for (int lane = 0; lane < 8; ++lane) {
+        s[8 * lane + i] = words[lane];
+    }
+}
+
+} // namespace
+
+/**
+ * Process one 64-byte block for each of eight messages.
+ * s holds eight SHA-256 states of 8 words each, back to back.
+ */
+void Transform_8way(uint32_t* s, const unsigned char* const* chunks)
+{
+    __m256i a = Load8(s, 0), b = Load8(s, 1), c = Load8(s, 2), d = Load8(s, 3);
+    __m256i e = Load8(s, 4), f = Load8(s, 5), g = Load8(s, 6), h = Load8(s, 7);
+    __m256i w[16];
+
+    for (int i = 0; i < 16; ++i) {
+        w[i] = Read8(chunks, i);
+    }
+
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            w[i & 15] = Add(sigma1(w[(i - 2) & 15]), w[(i - 7) & 15], sigma0(w[(i - 15) & 15]), w[i & 15]);
+        }
+        __m256i t1 = Add(h, Sigma1(e), Ch(e, f, g), _mm256_set1_epi32(K[i]), w[i & 15]);
+        __m256i t2 = Add(Sigma0(a), Maj(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Add(t1, t2);
+    }
+
+    Store8(s, 0, Add(a, Load8(s, 0)));
+    Store8(s, 1, Add(b, Load8(s, 1)));
+    Store8(s, 2, Add(c, Load8(s, 2)));
+    Store8(s, 3, Add(d, Load8(s, 3)));
+    Store8(s, 4, Add(e, Load8(s, 4)));
+    Store8(s, 5, Add(f, Load8(s, 5)));
+    Store8(s, 6, Add(g, Load8(s, 6)));
+    Store8(s, 7, Add(h, Load8(s, 7)));
+}
+
+} // namespace sha256_avx2
+
+#endif
@@ -0,0 +1,112 @@
+// Copyright (c) 2018 The Bitcoin Post-Quantum developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// This is a 4-way SSE4.1 multi-buffer SHA-256 transform: it processes one
+// 64-byte block of four independent messages at once, one per 32-bit lane.
+
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+
+namespace sha256_sse41 {
+namespace {
+
+static const uint32_t K[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul,
+};
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z) { return Add(Add(x, y), z); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z, __m128i w) { return Add(Add(x, y), Add(z, w)); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z, __m128i w, __m128i v) { return Add(Add(x, y, z), Add(w, v)); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Xor(__m128i x, __m128i y, __m128i z) { return Xor(Xor(x, y), z); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+__m128i inline ShR(__m128i x, int n) { return _mm_srli_epi32(x, n); }
+__m128i inline ShL(__m128i x, int n) { return _mm_slli_epi32(x, n); }
+
+__m128i inline Ch(__m128i x, __m128i y, __m128i z) { return Xor(z, And(x, Xor(y, z))); }
+__m128i inline Maj(__m128i x, __m128i y, __m128i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m128i inline Sigma0(__m128i x) { return Xor(Or(ShR(x, 2), ShL(x, 30)), Or(ShR(x, 13), ShL(x, 19)), Or(ShR(x, 22), ShL(x, 10))); }
+__m128i inline Sigma1(__m128i x) { return Xor(Or(ShR(x, 6), ShL(x, 26)), Or(ShR(x, 11), ShL(x, 21)), Or(ShR(x, 25), ShL(x, 7))); }
+__m128i inline sigma0(__m128i x) { return Xor(Or(ShR(x, 7), ShL(x, 25)), Or(ShR(x, 18), ShL(x, 14)), ShR(x, 3)); }
+__m128i inline sigma1(__m128i x) { return Xor(Or(ShR(x, 17), ShL(x, 15)), Or(ShR(x, 19), ShL(x, 13)), ShR(x, 10)); }
+
+/** Load big-endian word i of each lane's block. */
+__m128i inline Read4(const unsigned char* const* chunks, int i)
+{
+    return _mm_set_epi32(ReadBE32(chunks[3] + 4 * i), ReadBE32(chunks[2] + 4 * i), ReadBE32(chunks[1] + 4 * i), ReadBE32(chunks[0] + 4 * i));
+}
+
+/** Load state word i of each lane. */
+__m128i inline Load4(const uint32_t* s, int i)
+{
+    return _mm_set_epi32(s[24 + i], s[16 + i], s[8 + i], s[i]);
+}
+
+/** Store state word i of each lane. */
+void inline Store4(uint32_t* s, int i, __m128i v)
+{
+    s[i] = _mm_extract_epi32(v, 0);
+    s[8 + i] = _mm_extract_epi32(v, 1);
+    s[16 + i] = _mm_extract_epi32(v, 2);
+    s[24 + i] = _mm_extract_epi32(v, 3);
+}
+
+} // namespace
+
+/**
+ * Process one 64-byte block for each of four messages.
+ * s holds four SHA-256 states of 8 words each, back to back.
+ */
+void Transform_4way(uint32_t* s, const unsigned char* const* chunks)
+{
+    __m128i a = Load4(s, 0), b = Load4(s, 1), c = Load4(s, 2), d = Load4(s, 3);
+    __m128i e = Load4(s, 4), f = Load4(s, 5), g = Load4(s, 6), h = Load4(s, 7);
+    __m128i w[16];
+
+    for (int i = 0; i < 16; ++i) {
+        w[i] = Read4(chunks, i);
+    }
+
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            w[i & 15] = Add(sigma1(w[(i - 2) & 15]), w[(i - 7) & 15], sigma0(w[(i - 15) & 15]), w[i & 15]);
+        }
+        __m128i t1 = Add(h, Sigma1(e), Ch(e, f, g), _mm_set1_epi32(K[i]), w[i & 15]);
+        __m128i t2 = Add(Sigma0(a), Maj(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Add(t1, t2);
+    }
+
+    Store4(s, 0, Add(a, Load4(s, 0)));
+    Store4(s, 1, Add(b, Load4(s, 1)));
+    Store4(s, 2, Add(c, Load4(s, 2)));
+    Store4(s, 3, Add(d, Load4(s, 3)));
+    Store4(s, 4, Add(e, Load4(s, 4)));
+    Store4(s, 5, Add(f, Load4(s, 5)));
+    Store4(s, 6, Add(g, Load4(s, 6)));
+    Store4(s, 7, Add(h, Load4(s, 7)));
+}
+
+} // namespace sha256_sse41
+
+#endif
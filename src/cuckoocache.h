@@ -176,6 +176,12 @@ private:
      */
     mutable std::vector<bool> epoch_flags;
 
+    /** aged_flags marks the elements which had not been erased yet when their
+     * epoch was aged out. Overwriting one of them is what insert() reports as
+     * an eviction; a lookup which erases the element clears its flag.
+     */
+    mutable bit_packed_atomic_flags aged_flags;
+
     /** epoch_heuristic_counter is used to determine when an epoch might be aged
      * & an expensive scan should be done.  epoch_heuristic_counter is
      * decremented on insert and reset to the new number of inserts which would
@@ -306,8 +312,11 @@ private:
             for (uint32_t i = 0; i < size; ++i)
                 if (epoch_flags[i])
                     epoch_flags[i] = false;
-                else
+                else {
+                    if (!collection_flags.bit_is_set(i))
+                        aged_flags.bit_set(i);
                     allow_erase(i);
+                }
             epoch_heuristic_counter = epoch_size;
         } else
             // reset the epoch_heuristic_counter to next do a scan when worst
@@ -324,7 +333,7 @@ public:
     /** You must always construct a cache with some elements via a subsequent
      * call to setup or setup_bytes, otherwise operations may segfault.
      */
-    cache() : table(), size(), collection_flags(0), epoch_flags(),
+    cache() : table(), size(), collection_flags(0), epoch_flags(), aged_flags(0),
     epoch_heuristic_counter(), epoch_size(), depth_limit(0), hash_function()
     {
     }
@@ -345,6 +354,9 @@ public:
         table.resize(size);
         collection_flags.setup(size);
         epoch_flags.resize(size);
+        aged_flags.setup(size);
+        for (uint32_t i = 0; i < size; ++i)
+            aged_flags.bit_unset(i);
         // Set to 45% as described above
         epoch_size = std::max((uint32_t)1, (45 * size) / 100);
         // Initially set to wait for a whole epoch
@@ -388,8 +400,11 @@ public:
      * now in the table, one previously inserted element is evicted from the
      * table, the entry attempted to be inserted is evicted.
      *
+     * @returns the number of elements the cache gave up on to make room (0 or
+     * 1): an element overwritten after its epoch was aged out without it being
+     * erased, or the element dropped when the insert ran out of depth
      */
-    inline void insert(Element e)
+    inline uint32_t insert(Element e)
     {
         epoch_check();
         uint32_t last_loc = invalid();
@@ -400,18 +415,21 @@ public:
         for (uint32_t loc : locs)
             if (table[loc] == e) {
                 please_keep(loc);
+                aged_flags.bit_unset(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return 0;
             }
         for (uint8_t depth = 0; depth < depth_limit; ++depth) {
             // First try to insert to an empty slot, if one exists
             for (uint32_t loc : locs) {
                 if (!collection_flags.bit_is_set(loc))
                     continue;
+                const uint32_t evicted = aged_flags.bit_is_set(loc);
+                aged_flags.bit_unset(loc);
                 table[loc] = std::move(e);
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return evicted;
             }
             /** Swap with the element at the location that was
             * not the last one looked at. Example:
@@ -437,6 +455,8 @@ public:
             // Recompute the locs -- unfortunately happens one too many times!
             locs = compute_hashes(e);
         }
+        // e is whichever element was displaced last; it is dropped
+        return 1;
     }
 
     /* contains iterates through the hash locations for a given element
@@ -469,8 +489,10 @@ public:
         std::array<uint32_t, 8> locs = compute_hashes(e);
         for (uint32_t loc : locs)
             if (table[loc] == e) {
-                if (erase)
+                if (erase) {
                     allow_erase(loc);
+                    aged_flags.bit_unset(loc);
+                }
                 return true;
             }
         return false;
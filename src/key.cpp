@@ -17,7 +17,9 @@
 #include <botan/auto_rng.h>
 #include <botan/xmss.h>
 
+#include <atomic>
 #include <stdexcept>
+#include <thread>
 
 #include <util.h>
 #include <utilstrencodings.h>
@@ -121,6 +123,36 @@ void CKey::MakeNewKey(CKeyType ktype)
 	}
 }
 
+bool CKey::MakeNewKeys(std::vector<CKey>& keys, CKeyType ktype, unsigned int nThreads, const std::atomic<bool>* interrupt)
+{
+	nThreads = std::max(1u, std::min<unsigned int>(nThreads, keys.size()));
+
+	std::atomic<size_t> next(0);
+	std::atomic<bool> fInterrupted(false);
+	auto worker = [&keys, &next, &fInterrupted, ktype, interrupt]()
+	{
+		for (size_t i = next++; i < keys.size(); i = next++)
+		{
+			// A single large tree takes minutes, so check before each one
+			if (interrupt && *interrupt)
+			{
+				fInterrupted = true;
+				return;
+			}
+			keys[i].MakeNewKey(ktype);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(nThreads - 1);
+	for (unsigned int i = 1; i < nThreads; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread & thread : threads)
+		thread.join();
+	return !fInterrupted;
+}
+
 unsigned int CKey::size() const
 {
 	return keydata.size();
@@ -195,8 +227,8 @@ CPrivKey CKey::GetPrivKey() const
 		LogPrintf("%s: xmss key size: %d\n", __func__, keydata.size());
 
         // TODO: make in DER format
-        //auto && privkey = raw_private_key();
-        auto && rawkey = raw_private_key();
+        // the hash tree is left out, CKey::Load rebuilds it
+        auto && rawkey = raw_short_key();
         privkey.assign(rawkey.begin(), rawkey.end());
 
 		LogPrintf("%s: xmss privkey size: %d\n", __func__, privkey.size());
@@ -245,8 +277,7 @@ bool CKey::Sign(const uint8_t * msg, size_t msg_size, std::vector<unsigned char>
             {
 				use_count = m_pKeyStore->GetKeyUseCountInc(keyid);
                 
-                // TODO: get key TXO count
-                size_t txo_count = 0;
+                size_t txo_count = m_pKeyStore->GetKeyTxoCount(keyid);
                 check_use_count(keydata.data(), keydata.size(), use_count, txo_count);
             }
 
@@ -301,8 +332,7 @@ bool CKey::SignHash(const uint256 &hash, std::vector<unsigned char>& vchSig, uin
         {
             use_count = m_pKeyStore->GetKeyUseCountInc(keyid);
             
-            // TODO: get key TXO count
-            size_t txo_count = 0;
+            size_t txo_count = m_pKeyStore->GetKeyTxoCount(keyid);
             check_use_count(keydata.data(), keydata.size(), use_count, txo_count);
         }
 
@@ -323,6 +353,18 @@ bool CKey::SignHash(const uint256 &hash, std::vector<unsigned char>& vchSig, uin
     return false;
 }
 
+bool CKey::SignXMSS(const uint8_t * msg, size_t msg_size, uint64_t nIndex, size_t nTxoCount, std::vector<unsigned char>& vchSig) const
+{
+	if (!fValid || !IsXMSS())
+		return false;
+
+	size_t use_count = nIndex;
+	check_use_count(keydata.data(), keydata.size(), use_count, nTxoCount);
+
+	vchSig = bpqcrypto::xmss_sign(msg, msg_size, keydata.data(), keydata.size(), use_count);
+	return true;
+}
+
 bool CKey::VerifyPubKey(const CPubKey& pubkey) const 
 {
 	std::string str = "BPQ key verification\n";
@@ -12,6 +12,7 @@
 #include <serialize.h>
 #include <uint256.h>
 
+#include <atomic>
 #include <stdexcept>
 #include <vector>
 
@@ -185,6 +186,15 @@ public:
     //! Generate a new private key using a cryptographic PRNG.
     void MakeNewKey(CKeyType ktype);
 
+    /**
+     * Generate a new private key of the given type for every entry of keys,
+     * building up to nThreads keys at the same time. Each XMSS key needs its
+     * whole hash tree, so this is what makes batches of XMSS keys cheap.
+     * When interrupt is set no further keys are started, and false is
+     * returned once the keys in progress are done.
+     */
+    static bool MakeNewKeys(std::vector<CKey>& keys, CKeyType ktype, unsigned int nThreads, const std::atomic<bool>* interrupt = nullptr);
+
     /**
      * Convert the private key to a CPrivKey (serialized OpenSSL private key data).
      * This is expensive.
@@ -214,6 +224,14 @@ public:
 	
     bool SignHash(const uint256& hash, std::vector<unsigned char>& vchSig, uint32_t test_case = 0) const;
 
+    /**
+     * Create an XMSS signature with a leaf index the caller has reserved with
+     * GetKeyUseCountInc() and the key's unspent output count from
+     * GetKeyTxoCount(). The key store is not touched, so several threads
+     * may sign with one key at once.
+     */
+	bool SignXMSS(const uint8_t * msg, size_t msg_size, uint64_t nIndex, size_t nTxoCount, std::vector<unsigned char>& vchSig) const;
+
     /**
      * Create a compact signature (65 bytes), which allows reconstructing the used public key.
      * The format is one header byte, followed by two times 32 bytes for the serialized r and s values.
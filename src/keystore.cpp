@@ -6,6 +6,8 @@
 
 #include <keystore.h>
 
+#include <crypto/ripemd160.h>
+#include <hash.h>
 #include <util.h>
 
 #include "base58.h"
@@ -14,6 +16,14 @@ bool CKeyStore::AddKey(const CKey &key) {
     return AddKeyPubKey(key, key.GetPubKey());
 }
 
+std::shared_ptr<const CKey> CKeyStore::GetKeyHandle(const CKeyID &address) const
+{
+    CKey key;
+    if (!GetKey(address, key))
+        return nullptr;
+    return std::make_shared<const CKey>(std::move(key));
+}
+
 void CBasicKeyStore::ImplicitlyLearnRelatedKeyScripts(const CPubKey& pubkey)
 {
     AssertLockHeld(cs_KeyStore);
@@ -37,21 +47,40 @@ void CBasicKeyStore::ImplicitlyLearnRelatedKeyScripts(const CPubKey& pubkey)
         CScript reedemscript = GetScriptForRawPubKey(pubkey);
         CScript script = GetScriptForDestination(WitnessV1ScriptHash(reedemscript));
         
-        mapScripts[CScriptID(reedemscript, 1)] = std::move(reedemscript);
-        mapScripts[CScriptID(script, 1)] = std::move(script);
-        
+        CScriptID redeem_id(reedemscript, 1);
+        CScriptID script_id(script, 1);
+        mapScripts[redeem_id] = std::move(reedemscript);
+        mapScripts[script_id] = std::move(script);
+        setScriptFilter.insert(redeem_id);
+        setScriptFilter.insert(script_id);
     } else
     {
         if (is_key_segwit_useable(pubkey)) {
             CScript script = GetScriptForDestination(WitnessV0KeyHash(key_id));
+            CScriptID script_id(script, 0);
             // This does not use AddCScript, as it may be overridden.
-            mapScripts[CScriptID(script, 0)] = std::move(script);
+            mapScripts[script_id] = std::move(script);
+            setScriptFilter.insert(script_id);
         }
     }
+    setScriptFilter.insert(key_id);
 }
 
 bool CBasicKeyStore::GetPubKey(const CKeyID &address, CPubKey &vchPubKeyOut) const
 {
+    {
+        LOCK(cs_KeyStore);
+        CompactKeyMap::const_iterator it = mapCompactKeys.find(address);
+        if (it != mapCompactKeys.end()) {
+            vchPubKeyOut = it->second.first;
+            return true;
+        }
+        std::map<CKeyID, CPubKey>::const_iterator mi = mapLazyKeys.find(address);
+        if (mi != mapLazyKeys.end()) {
+            vchPubKeyOut = mi->second;
+            return true;
+        }
+    }
     CKey key;
     if (!GetKey(address, key)) {
         LOCK(cs_KeyStore);
@@ -69,15 +98,63 @@ bool CBasicKeyStore::GetPubKey(const CKeyID &address, CPubKey &vchPubKeyOut) con
 bool CBasicKeyStore::AddKeyPubKey(const CKey& key, const CPubKey &pubkey)
 {
     LOCK(cs_KeyStore);
-    mapKeys[pubkey.GetID()] = key;
+    CKeyID address = pubkey.GetID();
+    if (key.IsXMSS()) {
+        mapCompactKeys[address] = std::make_pair(pubkey, key.raw_short_key());
+        CacheXMSSKey(address, key);
+    } else {
+        mapKeys[address] = key;
+    }
+    ImplicitlyLearnRelatedKeyScripts(pubkey);
+    return true;
+}
+
+bool CBasicKeyStore::LoadCompactKey(const CPubKey &pubkey, const CKeyingMaterial& vchSecret, bool fSkipCheck)
+{
+    if (!pubkey.IsXMSS())
+        return false;
+
+    CKeyingMaterial vchCompact = GetCompactXMSSSecret(vchSecret);
+    if (vchCompact.empty())
+        return false;
+    if (!fSkipCheck && !VerifyXMSSSecret(vchCompact, pubkey))
+        return false;
+
+    LOCK(cs_KeyStore);
+    mapLazyKeys.erase(pubkey.GetID());
+    mapCompactKeys[pubkey.GetID()] = std::make_pair(pubkey, std::move(vchCompact));
+    ImplicitlyLearnRelatedKeyScripts(pubkey);
+    return true;
+}
+
+bool CBasicKeyStore::LoadLazyKey(const CPubKey &pubkey)
+{
+    if (!pubkey.IsXMSS())
+        return false;
+
+    LOCK(cs_KeyStore);
+    mapCompactKeys.erase(pubkey.GetID());
+    mapLazyKeys[pubkey.GetID()] = pubkey;
     ImplicitlyLearnRelatedKeyScripts(pubkey);
     return true;
 }
 
+bool CBasicKeyStore::FetchLazyKeys()
+{
+    LOCK(cs_KeyStore);
+    while (!mapLazyKeys.empty()) {
+        CPubKey pubkey = mapLazyKeys.begin()->second;
+        CKeyingMaterial vchSecret;
+        if (!ReadLazyKey(pubkey, vchSecret) || !LoadCompactKey(pubkey, vchSecret, false))
+            return false;
+    }
+    return true;
+}
+
 bool CBasicKeyStore::HaveKey(const CKeyID &address) const
 {
     LOCK(cs_KeyStore);
-    return mapKeys.count(address) > 0;
+    return mapKeys.count(address) > 0 || mapCompactKeys.count(address) > 0 || mapLazyKeys.count(address) > 0;
 }
 
 std::set<CKeyID> CBasicKeyStore::GetKeys() const
@@ -87,19 +164,132 @@ std::set<CKeyID> CBasicKeyStore::GetKeys() const
     for (const auto& mi : mapKeys) {
         set_address.insert(mi.first);
     }
+    for (const auto& mi : mapCompactKeys) {
+        set_address.insert(mi.first);
+    }
+    for (const auto& mi : mapLazyKeys) {
+        set_address.insert(mi.first);
+    }
     return set_address;
 }
 
 bool CBasicKeyStore::GetKey(const CKeyID &address, CKey &keyOut) const
 {
+    CKeyingMaterial vchSecret;
+    CPubKey pubkeyLazy;
+    {
+        LOCK(cs_KeyStore);
+        KeyMap::const_iterator mi = mapKeys.find(address);
+        if (mi != mapKeys.end()) {
+            keyOut = mi->second;
+            keyOut.AssignKeyStore(const_cast<CBasicKeyStore*>(this));
+            return true;
+        }
+        CompactKeyMap::const_iterator it = mapCompactKeys.find(address);
+        std::map<CKeyID, CPubKey>::const_iterator li = mapLazyKeys.find(address);
+        if (it == mapCompactKeys.end() && li == mapLazyKeys.end())
+            return false;
+        if (std::shared_ptr<const CKey> pkey = GetCachedXMSSKey(address)) {
+            keyOut = *pkey;
+            return true;
+        }
+        if (it != mapCompactKeys.end())
+            vchSecret = it->second.second;
+        else
+            pubkeyLazy = li->second;
+    }
+    // the secret is not kept, the expanded key cache holds the keys in use
+    if (pubkeyLazy.IsValid() && (!ReadLazyKey(pubkeyLazy, vchSecret) || !VerifyXMSSSecret(vchSecret, pubkeyLazy))) {
+        LogPrintf("%s: failed to read the secret of key %s\n", __func__, address.ToString());
+        return false;
+    }
+    return ExpandXMSSKey(address, vchSecret, keyOut);
+}
+
+std::shared_ptr<const CKey> CBasicKeyStore::GetKeyHandle(const CKeyID &address) const
+{
+    {
+        LOCK(cs_KeyStore);
+        if (std::shared_ptr<const CKey> pkey = GetCachedXMSSKey(address))
+            return pkey;
+    }
+    // GetKey caches the XMSS keys it expands, hand out that copy
+    CKey key;
+    if (!GetKey(address, key))
+        return nullptr;
     LOCK(cs_KeyStore);
-    KeyMap::const_iterator mi = mapKeys.find(address);
-    if (mi != mapKeys.end()) {
-        keyOut = mi->second;
-		keyOut.AssignKeyStore(const_cast<CBasicKeyStore*>(this));
+    if (std::shared_ptr<const CKey> pkey = GetCachedXMSSKey(address))
+        return pkey;
+    return std::make_shared<const CKey>(std::move(key));
+}
+
+bool CBasicKeyStore::ExpandXMSSKey(const CKeyID &address, const CKeyingMaterial& vchSecret, CKey& keyOut) const
+{
+    // rebuilds the hash tree of a short key, which takes seconds for the
+    // larger heights
+    CKey key;
+    key.Set(vchSecret);
+    if (!key.IsValid())
+        return false;
+
+    LOCK(cs_KeyStore);
+    // another thread may have expanded the key meanwhile
+    if (std::shared_ptr<const CKey> pkey = GetCachedXMSSKey(address)) {
+        keyOut = *pkey;
         return true;
     }
-    return false;
+    keyOut = std::move(key);
+    keyOut.AssignKeyStore(const_cast<CBasicKeyStore*>(this));
+    CacheXMSSKey(address, keyOut);
+    return true;
+}
+
+std::shared_ptr<const CKey> CBasicKeyStore::GetCachedXMSSKey(const CKeyID &address) const
+{
+    AssertLockHeld(cs_KeyStore);
+    auto it = mapXMSSKeyCache.find(address);
+    if (it == mapXMSSKeyCache.end())
+        return nullptr;
+
+    // move to the front of the LRU list
+    listXMSSKeyCache.splice(listXMSSKeyCache.begin(), listXMSSKeyCache, it->second);
+    return it->second->second;
+}
+
+void CBasicKeyStore::CacheXMSSKey(const CKeyID &address, const CKey& key) const
+{
+    AssertLockHeld(cs_KeyStore);
+    if (key.size() > nXMSSKeyCacheMaxSize || mapXMSSKeyCache.count(address))
+        return;
+
+    CKey keyCached(key);
+    keyCached.AssignKeyStore(const_cast<CBasicKeyStore*>(this));
+    listXMSSKeyCache.emplace_front(address, std::make_shared<const CKey>(std::move(keyCached)));
+    mapXMSSKeyCache[address] = listXMSSKeyCache.begin();
+    nXMSSKeyCacheSize += key.size();
+
+    while (nXMSSKeyCacheSize > nXMSSKeyCacheMaxSize) {
+        nXMSSKeyCacheSize -= listXMSSKeyCache.back().second->size();
+        mapXMSSKeyCache.erase(listXMSSKeyCache.back().first);
+        listXMSSKeyCache.pop_back();
+    }
+}
+
+void CBasicKeyStore::ClearXMSSKeyCache()
+{
+    AssertLockHeld(cs_KeyStore);
+    // the secure allocator wipes the keys once their last user releases them
+    mapXMSSKeyCache.clear();
+    listXMSSKeyCache.clear();
+    nXMSSKeyCacheSize = 0;
+}
+
+void CBasicKeyStore::SetXMSSKeyCacheSize(size_t nBytes)
+{
+    LOCK(cs_KeyStore);
+    nXMSSKeyCacheMaxSize = nBytes;
+    if (nXMSSKeyCacheSize > nXMSSKeyCacheMaxSize)
+        ClearXMSSKeyCache();
 }
 
 std::pair<size_t,size_t> CBasicKeyStore::GetKeyUseCount(const CTxDestination &dest) const
@@ -179,8 +369,10 @@ bool CBasicKeyStore::AddCScript(const CScript& redeemScript, int version)
     if (redeemScript.size() > MAX_SCRIPT_ELEMENT_SIZE)
         return error("CBasicKeyStore::AddCScript(): redeemScripts > %i bytes are invalid", MAX_SCRIPT_ELEMENT_SIZE);
 
+    CScriptID script_id(redeemScript, version);
     LOCK(cs_KeyStore);
-    mapScripts[CScriptID(redeemScript, version)] = redeemScript;
+    mapScripts[script_id] = redeemScript;
+    setScriptFilter.insert(script_id);
     return true;
 }
 
@@ -249,6 +441,60 @@ bool CBasicKeyStore::HaveWatchOnly() const
     return (!setWatchOnly.empty());
 }
 
+/**
+ * The id IsMine has to find in the key store before a script can be ours:
+ * the key id for P2PK and P2PKH, the script id for P2SH and P2WSH (v0 and v1),
+ * and the key hash for P2WPKH. Returns false for scripts which need Solver.
+ */
+static bool GetScriptFilterId(const CScript& script, uint160& id)
+{
+    if (script.IsPayToScriptHash()) {
+        memcpy(id.begin(), &script[2], 20);
+        return true;
+    }
+    if (script.size() == 25 && script[0] == OP_DUP && script[1] == OP_HASH160 && script[2] == 20 &&
+        script[23] == OP_EQUALVERIFY && script[24] == OP_CHECKSIG) {
+        memcpy(id.begin(), &script[3], 20);
+        return true;
+    }
+
+    int witnessversion;
+    std::vector<unsigned char> program;
+    if (script.IsWitnessProgram(witnessversion, program)) {
+        if (witnessversion == 0 && program.size() == 20) {
+            id = uint160(program);
+            return true;
+        }
+        if (witnessversion <= 1 && program.size() == 32) {
+            CRIPEMD160().Write(program.data(), program.size()).Finalize(id.begin());
+            return true;
+        }
+        return false;
+    }
+
+    CScript::const_iterator pc = script.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> vch;
+    if (script.GetOp(pc, opcode, vch) && !vch.empty() &&
+        script.GetOp(pc, opcode) && opcode == OP_CHECKSIG && pc == script.end()) {
+        id = Hash160(vch.begin(), vch.end());
+        return true;
+    }
+    return false;
+}
+
+bool CBasicKeyStore::MayOwnScript(const CScript& scriptPubKey) const
+{
+    uint160 id;
+    if (!GetScriptFilterId(scriptPubKey, id))
+        return true;
+
+    LOCK(cs_KeyStore);
+    if (setScriptFilter.count(id))
+        return true;
+    return !setWatchOnly.empty() && setWatchOnly.count(scriptPubKey);
+}
+
 CKeyID GetKeyForDestination(const CKeyStore& store, const CTxDestination& dest)
 {
     // Only supports destinations which map to single public keys, i.e. P2PKH,
@@ -291,3 +537,21 @@ CKeyID GetKeyForDestination(const CKeyStore& store, const CTxDestination& dest)
     
     return CKeyID();
 }
+
+CKeyingMaterial GetCompactXMSSSecret(const CKeyingMaterial& vchSecret)
+{
+    if (bpqcrypto::is_xmss_short_key(vchSecret.data(), vchSecret.size()))
+        return vchSecret;
+    if (bpqcrypto::is_xmss_key(vchSecret.data(), vchSecret.size()))
+        return bpqcrypto::xmss_get_short_key(vchSecret);
+    return {};
+}
+
+bool VerifyXMSSSecret(const CKeyingMaterial& vchSecret, const CPubKey& pubkey)
+{
+    // the public key is a prefix of both key forms, see crypt_xmss.h
+    if (!bpqcrypto::is_xmss_short_key(vchSecret.data(), vchSecret.size()) &&
+        !bpqcrypto::is_xmss_key(vchSecret.data(), vchSecret.size()))
+        return false;
+    return CPubKey(bpqcrypto::xmss_get_pubkey(vchSecret)) == pubkey;
+}
@@ -7,14 +7,29 @@
 #ifndef BITCOIN_KEYSTORE_H
 #define BITCOIN_KEYSTORE_H
 
+#include <crypto/common.h>
 #include <key.h>
 #include <pubkey.h>
 #include <script/script.h>
 #include <script/standard.h>
+#include <support/allocators/secure.h>
 #include <sync.h>
 
 #include <boost/signals2/signal.hpp>
 
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_set>
+
+//! Size of an expanded XMSS_256_H20 key, the largest kind: its hash tree holds
+//! up to 2^21 nodes of 32 bytes
+static const size_t XMSS_MAX_EXPANDED_KEY_SIZE = (size_t(2) << 20) * 32;
+//! -xmsskeycache default (MiB), room for two expanded keys of the largest kind
+//! next to smaller ones
+static const unsigned int DEFAULT_XMSS_KEY_CACHE_SIZE = 160;
+static_assert((size_t(DEFAULT_XMSS_KEY_CACHE_SIZE) << 20) > 2 * XMSS_MAX_EXPANDED_KEY_SIZE, "the default XMSS key cache must hold two of the largest keys");
+
 /** A virtual base class for key stores */
 class CKeyStore
 {
@@ -31,6 +46,8 @@ public:
     //! Check whether a key corresponding to a given address is present in the store.
     virtual bool HaveKey(const CKeyID &address) const =0;
     virtual bool GetKey(const CKeyID &address, CKey& keyOut) const =0;
+    //! Like GetKey, but key stores that keep expanded keys hand out their own copy instead of a new one.
+    virtual std::shared_ptr<const CKey> GetKeyHandle(const CKeyID &address) const;
     virtual std::set<CKeyID> GetKeys() const =0;
     virtual bool GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const =0;
 
@@ -39,6 +56,8 @@ public:
 	
     virtual uint64_t GetKeyUseCountInc(const CKeyID &address) = 0;
     virtual bool SetKeyUseCount(const CKeyID &address, uint64_t use_count) = 0;
+    //! Number of unspent outputs paying to a key, which each need a leaf of their own to be spent.
+    virtual size_t GetKeyTxoCount(const CKeyID &address) const { return 0; }
 
     //! Support for BIP 0013 : see https://github.com/bitcoin/bips/blob/master/bip-0013.mediawiki
     virtual bool AddCScript(const CScript& redeemScript, int version) =0;
@@ -56,32 +75,93 @@ public:
     virtual bool RemoveWatchOnly(const CScript &dest) =0;
     virtual bool HaveWatchOnly(const CScript &dest) const =0;
     virtual bool HaveWatchOnly() const =0;
+
+    //! Cheap prefilter for IsMine: false means the script can not be ours,
+    //! true means the full check has to run.
+    virtual bool MayOwnScript(const CScript& scriptPubKey) const { return true; }
 };
 
+typedef bpqcrypto::secure_vector<uint8_t> CKeyingMaterial;
 typedef std::map<CKeyID, CKey> KeyMap;
+typedef std::map<CKeyID, std::pair<CPubKey, CKeyingMaterial> > CompactKeyMap;
 typedef std::map<CKeyID, CPubKey> WatchKeyMap;
 typedef std::map<CScriptID, CScript > ScriptMap;
 typedef std::set<CScript> WatchOnlySet;
 
+/** Key and script ids are hash outputs already, so a part of them hashes well enough */
+struct ScriptFilterHasher
+{
+    size_t operator()(const uint160& id) const { return ReadLE64(id.begin()); }
+};
+
 /** Basic key store, that keeps keys in an address->secret map */
 class CBasicKeyStore : public CKeyStore
 {
+private:
+    /**
+     * XMSS keys expanded from their compact or stored long form, bounded by
+     * nXMSSKeyCacheMaxSize bytes (least recently used keys are dropped first).
+     * The key data is held by Botan's secure_allocator, which wipes it when it
+     * is released. It is only locked in memory as far as Botan's small mlock
+     * pool has room, which expanded keys mostly do not fit in. Keys are shared
+     * with GetKeyHandle() callers and outlive an eviction while in use.
+     */
+    typedef std::list<std::pair<CKeyID, std::shared_ptr<const CKey> > > XMSSKeyCacheList;
+    mutable XMSSKeyCacheList listXMSSKeyCache;
+    mutable std::map<CKeyID, XMSSKeyCacheList::iterator> mapXMSSKeyCache;
+    mutable size_t nXMSSKeyCacheSize;
+    size_t nXMSSKeyCacheMaxSize;
+
 protected:
     KeyMap mapKeys;
+    //! XMSS keys without their cached hash tree (see crypt_xmss.h), which is
+    //! rebuilt on demand by GetKey
+    CompactKeyMap mapCompactKeys;
+    //! XMSS keys whose secret was left in the backing store, see ReadLazyKey
+    std::map<CKeyID, CPubKey> mapLazyKeys;
     WatchKeyMap mapWatchKeys;
     ScriptMap mapScripts;
     WatchOnlySet setWatchOnly;
 	std::map<CKeyID, uint64_t> mapKeyUseCount;
+    //! Ids of all keys and scripts ever added, see MayOwnScript. Entries are
+    //! never removed, a superset only costs a full IsMine now and then.
+    std::unordered_set<uint160, ScriptFilterHasher> setScriptFilter;
 
     void ImplicitlyLearnRelatedKeyScripts(const CPubKey& pubkey);
 
+    std::shared_ptr<const CKey> GetCachedXMSSKey(const CKeyID &address) const;
+    void CacheXMSSKey(const CKeyID &address, const CKey& key) const;
+    void ClearXMSSKeyCache();
+
+    //! Expand a compact XMSS key and cache it. The hash tree is rebuilt with
+    //! cs_KeyStore released, callers must not hold it.
+    bool ExpandXMSSKey(const CKeyID &address, const CKeyingMaterial& vchSecret, CKey& keyOut) const;
+
+    //! Fetch the secret of a lazily loaded key from the backing store, in
+    //! either form. Keys stored in long form expand without a rebuild.
+    virtual bool ReadLazyKey(const CPubKey &pubkey, CKeyingMaterial& vchSecret) const { return false; }
+
 public:
-	
+    CBasicKeyStore() : nXMSSKeyCacheSize(0), nXMSSKeyCacheMaxSize(DEFAULT_XMSS_KEY_CACHE_SIZE << 20) {}
+
+    //! Add an XMSS key in short or long form without expanding it
+    bool LoadCompactKey(const CPubKey &pubkey, const CKeyingMaterial& vchSecret, bool fSkipCheck);
+
+    //! Add an XMSS key whose secret is only read on first use, replacing
+    //! its compact secret if one is held
+    bool LoadLazyKey(const CPubKey &pubkey);
+    //! Read the secrets of all lazily loaded keys into memory
+    bool FetchLazyKeys();
+
+    //! Set the byte budget of the expanded XMSS key cache, 0 disables it
+    void SetXMSSKeyCacheSize(size_t nBytes);
+
     bool AddKeyPubKey(const CKey& key, const CPubKey &pubkey) override;
     bool GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const override;
     bool HaveKey(const CKeyID &address) const override;
     std::set<CKeyID> GetKeys() const override;
     bool GetKey(const CKeyID &address, CKey &keyOut) const override;
+    std::shared_ptr<const CKey> GetKeyHandle(const CKeyID &address) const override;
     bool AddCScript(const CScript& redeemScript, int version) override;
     bool HaveCScript(const CScriptID &hash) const override;
     std::set<CScriptID> GetCScripts() const override;
@@ -96,11 +176,18 @@ public:
     bool RemoveWatchOnly(const CScript &dest) override;
     bool HaveWatchOnly(const CScript &dest) const override;
     bool HaveWatchOnly() const override;
+
+    bool MayOwnScript(const CScript& scriptPubKey) const override;
 };
 
-typedef bpqcrypto::secure_vector<uint8_t> CKeyingMaterial;
 typedef std::map<CKeyID, std::pair<CPubKey, std::vector<unsigned char> > > CryptedKeyMap;
 
+/** Returns the compact (short) form of an XMSS secret, which may be given in either form */
+CKeyingMaterial GetCompactXMSSSecret(const CKeyingMaterial& vchSecret);
+
+/** Check an XMSS secret in either form against its public key without expanding it */
+bool VerifyXMSSSecret(const CKeyingMaterial& vchSecret, const CPubKey& pubkey);
+
 /** Return the CKeyID of the key involved in a script (if there is a unique one). */
 CKeyID GetKeyForDestination(const CKeyStore& store, const CTxDestination& dest);
 
@@ -50,15 +50,15 @@ uint64_t nLastBlockWeight = 0;
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
-    int64_t nOldTime = pblock->nTime;
+    int64_t nOldTime = pblock->GetBlockTime();
     int64_t nNewTime = std::max(pindexPrev->GetMedianTimePast()+1, GetAdjustedTime());
 
     if (nOldTime < nNewTime)
-        pblock->nTime = nNewTime;
+        pblock->SetTime(nNewTime);
 
     // Updating time can change work required on testnet:
     if (consensusParams.fPowAllowMinDifficultyBlocks)
-        pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, consensusParams);
+        pblock->SetBits(GetNextWorkRequired(pindexPrev, pblock, consensusParams));
 
     return nNewTime - nOldTime;
 }
@@ -150,17 +150,17 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     nHeight = pindexPrev->nHeight + 1;
 
     if (nHeight >= chainparams.GetConsensus().BPQHeight)
-        pblock->nMajorVersion = CBlockHeader::BPQ_MAJOR_VERSION;
+        pblock->SetMajorVersion(CBlockHeader::BPQ_MAJOR_VERSION);
     else
-        pblock->nMajorVersion = CBlockHeader::BITCOIN_MAJOR_VERSION;
+        pblock->SetMajorVersion(CBlockHeader::BITCOIN_MAJOR_VERSION);
 
-    pblock->nMinorVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+    pblock->SetMinorVersion(ComputeBlockVersion(pindexPrev, chainparams.GetConsensus()));
     // -regtest only: allow overriding block.nVersion with
     // -blockversion=N to test forking scenarios
     if (chainparams.MineBlocksOnDemand())
-        pblock->nMinorVersion = gArgs.GetArg("-blockversion", pblock->nMinorVersion);
+        pblock->SetMinorVersion(gArgs.GetArg("-blockversion", pblock->GetMinorVersion()));
 
-    pblock->nTime = GetAdjustedTime();
+    pblock->SetTime(GetAdjustedTime());
     const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
 
     nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
@@ -195,14 +195,14 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
     pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
 
-    if (pblock->nMajorVersion == CBlock::BITCOIN_MAJOR_VERSION)
+    if (pblock->GetMajorVersion() == CBlock::BITCOIN_MAJOR_VERSION)
     {
         pblocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, chainparams.GetConsensus());
     }
     else
     {
         pblocktemplate->vchCoinbaseCommitment.clear();
-        pblock->hashWitnessMerkleRoot = BlockWitnessMerkleRoot(*pblock, nullptr);
+        pblock->SetHashWitnessMerkleRoot(BlockWitnessMerkleRoot(*pblock, nullptr));
     }
 
     pblocktemplate->vTxFees[0] = -nFees;
@@ -222,11 +222,11 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
 
     // Fill in header
-    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
+    pblock->SetHashPrevBlock(pindexPrev->GetBlockHash());
     UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
-    pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
-    pblock->nNonce         = ArithToUint256(nonce);
-    pblock->nSolution.resize(chainparams.GetConsensus().nSolutionSize);
+    pblock->SetBits(GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus()));
+    pblock->SetNonce(ArithToUint256(nonce));
+    pblock->SetSolution(std::vector<unsigned char>(chainparams.GetConsensus().nSolutionSize));
     pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
 
     CValidationState state;
@@ -510,10 +510,10 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 {
     // Update nExtraNonce
     static uint256 hashPrevBlock;
-    if (hashPrevBlock != pblock->hashPrevBlock)
+    if (hashPrevBlock != pblock->GetHashPrevBlock())
     {
         nExtraNonce = 0;
-        hashPrevBlock = pblock->hashPrevBlock;
+        hashPrevBlock = pblock->GetHashPrevBlock();
     }
     ++nExtraNonce;
     unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
@@ -522,5 +522,5 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    pblock->SetHashMerkleRoot(BlockMerkleRoot(*pblock));
 }
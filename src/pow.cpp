@@ -113,13 +113,13 @@ bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& param
     // I||V
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << I;
-    ss << pblock->nNonce;
+    ss << pblock->GetNonce();
 
     // H(I||V||...
     crypto_generichash_blake2b_update(&state, (unsigned char*)&ss[0], ss.size());
 
     bool isValid;
-    EhIsValidSolution(n, k, state, pblock->nSolution, isValid);
+    EhIsValidSolution(n, k, state, pblock->GetSolution(), isValid);
     if (!isValid)
         return error("CheckEquihashSolution(): invalid solution");
 
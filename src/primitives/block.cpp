@@ -14,7 +14,7 @@
 #include "crypto/common.h"
 
 
-uint256 CBlockHeader::GetHash() const
+uint256 CBlockHeader::ComputeHash() const
 {
     CHashWriter writer(SER_GETHASH, PROTOCOL_VERSION);
 
@@ -32,11 +32,11 @@ std::string CBlock::ToString() const
     std::stringstream s;
     s << strprintf("CBlock(hash=%s, ver=%u.%08x, hashPrevBlock=%s, hashMerkleRoot=%s, nTime=%u, nBits=%08x, nNonce=%s, vtx=%u)\n",
         GetHash().ToString(),
-                   nMajorVersion,
-        nMinorVersion,
-        hashPrevBlock.ToString(),
-        hashMerkleRoot.ToString(),
-        nTime, nBits, nNonce.GetHex(),
+                   GetMajorVersion(),
+        GetMinorVersion(),
+        GetHashPrevBlock().ToString(),
+        GetHashMerkleRoot().ToString(),
+        GetBlockTime(), GetBits(), GetNonce().GetHex(),
         vtx.size());
     for (const auto& tx : vtx) {
         s << "  " << tx->ToString() << "\n";
@@ -30,6 +30,11 @@ public:
     static const uint8_t BITCOIN_MAJOR_VERSION = 0;
     static const uint8_t BPQ_MAJOR_VERSION = 1;
 
+private:
+    // The fields are only written through the setters below, which drop the
+    // cached hash.
+    friend class CEquihashInput;
+
     uint8_t nMajorVersion;  // used for hard forks
     int32_t nMinorVersion;  // used for soft forks
 
@@ -43,6 +48,10 @@ public:
     uint256 nNonce;
     std::vector<unsigned char> nSolution;  // Equihash solution.
 
+    // memory only: hash of a header that was deserialized, see GetHash()
+    uint256 hashCached;
+
+public:
     CBlockHeader()
     {
         SetNull();
@@ -65,6 +74,11 @@ public:
 
         READWRITE(nNonce);
         READWRITE(nSolution);  // var_int
+
+        // Headers from the network or disk are not modified after reading,
+        // so hash them once here instead of on every GetHash() call.
+        if (ser_action.ForRead())
+            hashCached = ComputeHash();
     }
 
     template <typename Stream>
@@ -103,6 +117,7 @@ public:
         nNonce = ArithToUint256(arith_uint256(legacy_nonce));
 
         nSolution.clear();
+        hashCached.SetNull();
     }
 
     void SetNull()
@@ -117,6 +132,7 @@ public:
         nBits = 0;
         nNonce.SetNull();
         nSolution.clear();
+        hashCached.SetNull();
     }
 
     bool IsNull() const
@@ -124,7 +140,40 @@ public:
         return (nBits == 0);
     }
 
-    uint256 GetHash() const;
+    uint8_t GetMajorVersion() const { return nMajorVersion; }
+    int32_t GetMinorVersion() const { return nMinorVersion; }
+    const uint256& GetHashPrevBlock() const { return hashPrevBlock; }
+    const uint256& GetHashMerkleRoot() const { return hashMerkleRoot; }
+    const uint256& GetHashWitnessMerkleRoot() const { return hashWitnessMerkleRoot; }
+    uint32_t GetBits() const { return nBits; }
+    const uint256& GetNonce() const { return nNonce; }
+    const std::vector<unsigned char>& GetSolution() const { return nSolution; }
+
+    void SetMajorVersion(uint8_t nMajorVersionIn) { nMajorVersion = nMajorVersionIn; hashCached.SetNull(); }
+    void SetMinorVersion(int32_t nMinorVersionIn) { nMinorVersion = nMinorVersionIn; hashCached.SetNull(); }
+    void SetHashPrevBlock(const uint256& hash) { hashPrevBlock = hash; hashCached.SetNull(); }
+    void SetHashMerkleRoot(const uint256& hash) { hashMerkleRoot = hash; hashCached.SetNull(); }
+    void SetHashWitnessMerkleRoot(const uint256& hash) { hashWitnessMerkleRoot = hash; hashCached.SetNull(); }
+    void SetTime(uint32_t nTimeIn) { nTime = nTimeIn; hashCached.SetNull(); }
+    void SetBits(uint32_t nBitsIn) { nBits = nBitsIn; hashCached.SetNull(); }
+    void SetNonce(const uint256& nNonceIn) { nNonce = nNonceIn; hashCached.SetNull(); }
+    void SetSolution(std::vector<unsigned char> nSolutionIn) { nSolution = std::move(nSolutionIn); hashCached.SetNull(); }
+
+    /**
+     * Returns the block hash. For a deserialized header this is the hash
+     * computed while reading it, until one of the setters changes a field.
+     * Headers that are built in memory (e.g. by the miner) are hashed on
+     * every call.
+     */
+    uint256 GetHash() const
+    {
+        if (!hashCached.IsNull())
+            return hashCached;
+        return ComputeHash();
+    }
+
+    //! Serialize and hash the header, ignoring any cached hash
+    uint256 ComputeHash() const;
 
     int64_t GetBlockTime() const
     {
@@ -170,17 +219,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nMajorVersion  = nMajorVersion;
-        block.nMinorVersion       = nMinorVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.hashWitnessMerkleRoot = hashWitnessMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
-        return block;
+        // Copies the cached hash along with the fields
+        return *this;
     }
 
     std::string ToString() const;
@@ -171,9 +171,13 @@ static bool rest_headers(HTTPRequest* req,
         }
     }
 
+    std::vector<CBlockHeader> blockHeaders;
+    if (!GetBlockHeaders(headers, blockHeaders))
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Block headers not readable");
+
     CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
-    for (const CBlockIndex *pindex : headers) {
-        ssHeader << pindex->GetBlockHeader();
+    for (const CBlockHeader& header : blockHeaders) {
+        ssHeader << header;
     }
 
     switch (rf) {
@@ -194,8 +198,8 @@ static bool rest_headers(HTTPRequest* req,
         UniValue jsonHeaders(UniValue::VARR);
         {
             LOCK(cs_main);
-            for (const CBlockIndex *pindex : headers) {
-                jsonHeaders.push_back(blockheaderToJSON(pindex));
+            for (size_t i = 0; i < headers.size(); i++) {
+                jsonHeaders.push_back(blockheaderToJSON(headers[i], blockHeaders[i].GetSolution()));
             }
         }
         std::string strJSON = jsonHeaders.write() + "\n";
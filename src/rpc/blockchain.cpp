@@ -18,6 +18,7 @@
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
+#include <script/sigcache.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -131,6 +132,15 @@ double GetDifficulty(const CBlockIndex* blockindex)
 
 
 UniValue blockheaderToJSON(const CBlockIndex* blockindex)
+{
+    AssertLockHeld(cs_main);
+    std::vector<unsigned char> solution;
+    if (!GetBlockSolution(blockindex, solution))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Can't read block solution from disk");
+    return blockheaderToJSON(blockindex, solution);
+}
+
+UniValue blockheaderToJSON(const CBlockIndex* blockindex, const std::vector<unsigned char>& solution)
 {
     AssertLockHeld(cs_main);
     UniValue result(UniValue::VOBJ);
@@ -150,7 +160,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
     result.push_back(Pair("nonceUint32", (uint64_t)((uint32_t)blockindex->nNonce.GetUint64(0))));
     result.push_back(Pair("nonce", blockindex->nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(blockindex->nSolution)));
+    result.push_back(Pair("solution", HexStr(solution)));
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
@@ -181,11 +191,11 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("weight", (int)::GetBlockWeight(block, consensusParams)));
     result.push_back(Pair("height", blockindex->nHeight));
-    result.push_back(Pair("majorversion", (int)block.nMajorVersion));
-    result.push_back(Pair("version", block.nMinorVersion));
-    result.push_back(Pair("versionHex", strprintf("%08x", block.nMinorVersion)));
-    result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    result.push_back(Pair("witnessmerkleroot", block.hashWitnessMerkleRoot.GetHex()));
+    result.push_back(Pair("majorversion", (int)block.GetMajorVersion()));
+    result.push_back(Pair("version", block.GetMinorVersion()));
+    result.push_back(Pair("versionHex", strprintf("%08x", block.GetMinorVersion())));
+    result.push_back(Pair("merkleroot", block.GetHashMerkleRoot().GetHex()));
+    result.push_back(Pair("witnessmerkleroot", block.GetHashWitnessMerkleRoot().GetHex()));
     UniValue txs(UniValue::VARR);
     for(const auto& tx : block.vtx)
     {
@@ -201,10 +211,10 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("tx", txs));
     result.push_back(Pair("time", block.GetBlockTime()));
     result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
-    result.push_back(Pair("nonceUint32", (uint64_t)((uint32_t)block.nNonce.GetUint64(0))));
-    result.push_back(Pair("nonce", block.nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(block.nSolution)));
-    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
+    result.push_back(Pair("nonceUint32", (uint64_t)((uint32_t)block.GetNonce().GetUint64(0))));
+    result.push_back(Pair("nonce", block.GetNonce().GetHex()));
+    result.push_back(Pair("solution", HexStr(block.GetSolution())));
+    result.push_back(Pair("bits", strprintf("%08x", block.GetBits())));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
     result.push_back(Pair("nTx", (uint64_t)blockindex->nTx));
@@ -764,8 +774,11 @@ UniValue getblockheader(const JSONRPCRequest& request)
 
     if (!fVerbose)
     {
+        CBlockHeader header;
+        if (!GetBlockHeader(pblockindex, header))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Can't read block header from disk");
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << pblockindex->GetBlockHeader();
+        ssBlock << header;
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
         return strHex;
     }
@@ -1463,6 +1476,50 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+static UniValue SignatureCacheStatsToJSON(const SignatureCacheStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    ret.push_back(Pair("inserts", stats.nInserts));
+    ret.push_back(Pair("evictions", stats.nEvictions));
+    ret.push_back(Pair("maxentries", (uint64_t)stats.nMaxElements));
+    return ret;
+}
+
+UniValue getsigcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getsigcacheinfo\n"
+            "\nReturns the counters of the signature verification caches since startup.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"ecdsa\": {                (json object) ECDSA signature cache\n"
+            "    \"hits\": xxxxx,           (numeric) Lookups that found a cached valid signature\n"
+            "    \"misses\": xxxxx,         (numeric) Lookups that had to verify the signature\n"
+            "    \"inserts\": xxxxx,        (numeric) Verified signatures added to the cache\n"
+            "    \"evictions\": xxxxx,      (numeric) Valid entries dropped to make room for new ones\n"
+            "    \"maxentries\": xxxxx      (numeric) Capacity of the cache\n"
+            "  },\n"
+            "  \"xmss\": {                 (json object) XMSS signature cache, same fields\n"
+            "    ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+        );
+
+    SignatureCacheStats ecdsa, xmss;
+    GetSignatureCacheStats(ecdsa, xmss);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("ecdsa", SignatureCacheStatsToJSON(ecdsa)));
+    ret.push_back(Pair("xmss", SignatureCacheStatsToJSON(xmss)));
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1691,6 +1748,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
+    { "blockchain",         "getsigcacheinfo",        &getsigcacheinfo,        {} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
@@ -155,13 +155,13 @@ UniValue generateBlocks(CScript const & coinbaseScript, int nGenerate, uint64_t
             LOCK(cs_main);
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
-        if (pblock->nMajorVersion == CBlockHeader::BITCOIN_MAJOR_VERSION) {
+        if (pblock->GetMajorVersion() == CBlockHeader::BITCOIN_MAJOR_VERSION) {
             // Solve sha256d.
             nInnerLoopMask = nInnerLoopBitcoinMask;
             nInnerLoopCount = nInnerLoopBitcoinCount;
-            while (nMaxTries > 0 && (int)pblock->nNonce.GetUint64(0) < nInnerLoopCount &&
-                   !CheckProofOfWork(pblock->GetHash(), pblock->nBits, false, Params().GetConsensus())) {
-                pblock->nNonce = ArithToUint256(UintToArith256(pblock->nNonce) + 1);
+            while (nMaxTries > 0 && (int)pblock->GetNonce().GetUint64(0) < nInnerLoopCount &&
+                   !CheckProofOfWork(pblock->GetHash(), pblock->GetBits(), false, Params().GetConsensus())) {
+                pblock->SetNonce(ArithToUint256(UintToArith256(pblock->GetNonce()) + 1));
                 --nMaxTries;
             }
         } else {
@@ -180,25 +180,25 @@ UniValue generateBlocks(CScript const & coinbaseScript, int nGenerate, uint64_t
             crypto_generichash_blake2b_update(&eh_state, (unsigned char*)&ss[0], ss.size());
 
             while (nMaxTries > 0 &&
-                   ((int)pblock->nNonce.GetUint64(0) & nInnerLoopEquihashMask) < nInnerLoopCount) {
+                   ((int)pblock->GetNonce().GetUint64(0) & nInnerLoopEquihashMask) < nInnerLoopCount) {
                 // Yes, there is a chance every nonce could fail to satisfy the -regtest
                 // target -- 1 in 2^(2^256). That ain't gonna happen
-                pblock->nNonce = ArithToUint256(UintToArith256(pblock->nNonce) + 1);
+                pblock->SetNonce(ArithToUint256(UintToArith256(pblock->GetNonce()) + 1));
 
                 // H(I||V||...
                 crypto_generichash_blake2b_state curr_state;
                 curr_state = eh_state;
                 crypto_generichash_blake2b_update(&curr_state,
-                                                  pblock->nNonce.begin(),
-                                                  pblock->nNonce.size());
+                                                  pblock->GetNonce().begin(),
+                                                  pblock->GetNonce().size());
 
                 // (x_1, x_2, ...) = A(I, V, n, k)
                 std::function<bool(std::vector<unsigned char>)> validBlock =
                         [&pblock](std::vector<unsigned char> soln) {
-                    pblock->nSolution = soln;
+                    pblock->SetSolution(soln);
                     // TODO(h4x3rotab): Add metrics counter like Zcash? `solutionTargetChecks.increment();`
                     // TODO(h4x3rotab): Maybe switch to EhBasicSolve and better deal with `nMaxTries`?
-                    return CheckProofOfWork(pblock->GetHash(), pblock->nBits, true, Params().GetConsensus());
+                    return CheckProofOfWork(pblock->GetHash(), pblock->GetBits(), true, Params().GetConsensus());
                 };
                 bool found = EhBasicSolveUncancellable(n, k, curr_state, validBlock);
                 --nMaxTries;
@@ -211,7 +211,7 @@ UniValue generateBlocks(CScript const & coinbaseScript, int nGenerate, uint64_t
         if (nMaxTries == 0) {
             break;
         }
-        if (((int)pblock->nNonce.GetUint64(0) & nInnerLoopMask) == nInnerLoopCount) {
+        if (((int)pblock->GetNonce().GetUint64(0) & nInnerLoopMask) == nInnerLoopCount) {
             continue;
         }
         std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
@@ -486,7 +486,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
 
             CBlockIndex* const pindexPrev = chainActive.Tip();
             // TestBlockValidity only supports blocks built on the current Tip
-            if (block.hashPrevBlock != pindexPrev->GetBlockHash())
+            if (block.GetHashPrevBlock() != pindexPrev->GetBlockHash())
                 return "inconclusive-not-best-prevblk";
             CValidationState state;
             TestBlockValidity(state, Params(), block, pindexPrev, false, true, false);
@@ -608,8 +608,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
 
     // Update nTime
     UpdateTime(pblock, consensusParams, pindexPrev);
-    pblock->nNonce = uint256();
-    pblock->nSolution.clear();
+    pblock->SetNonce(uint256());
+    pblock->SetSolution(std::vector<unsigned char>());
 
     // NOTE: If at some point we support pre-segwit miners post-segwit-activation, this needs to take segwit support into consideration
     const bool fPreSegWit = (THRESHOLD_ACTIVE != VersionBitsState(pindexPrev, consensusParams, Consensus::DEPLOYMENT_SEGWIT, versionbitscache));
@@ -657,7 +657,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     UniValue aux(UniValue::VOBJ);
     aux.push_back(Pair("flags", HexStr(COINBASE_FLAGS.begin(), COINBASE_FLAGS.end())));
 
-    arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+    arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->GetBits());
 
     UniValue aMutable(UniValue::VARR);
     aMutable.push_back("time");
@@ -679,7 +679,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
                 break;
             case THRESHOLD_LOCKED_IN:
                 // Ensure bit is set in block version
-                pblock->nMinorVersion |= VersionBitsMask(consensusParams, pos);
+                pblock->SetMinorVersion(pblock->GetMinorVersion() | VersionBitsMask(consensusParams, pos));
                 // FALL THROUGH to get vbavailable set...
             case THRESHOLD_STARTED:
             {
@@ -688,7 +688,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
                 if (setClientRules.find(vbinfo.name) == setClientRules.end()) {
                     if (!vbinfo.gbt_force) {
                         // If the client doesn't support this, don't indicate it in the [default] version
-                        pblock->nMinorVersion &= ~VersionBitsMask(consensusParams, pos);
+                        pblock->SetMinorVersion(pblock->GetMinorVersion() & ~VersionBitsMask(consensusParams, pos));
                     }
                 }
                 break;
@@ -710,8 +710,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         }
     }
 
-    result.push_back(Pair("majorversion", (int)pblock->nMajorVersion));
-    result.push_back(Pair("version", pblock->nMinorVersion));
+    result.push_back(Pair("majorversion", (int)pblock->GetMajorVersion()));
+    result.push_back(Pair("version", pblock->GetMinorVersion()));
     result.push_back(Pair("rules", aRules));
     result.push_back(Pair("vbavailable", vbavailable));
     result.push_back(Pair("vbrequired", int(0)));
@@ -724,7 +724,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         aMutable.push_back("version/force");
     }
 
-    result.push_back(Pair("previousblockhash", pblock->hashPrevBlock.GetHex()));
+    result.push_back(Pair("previousblockhash", pblock->GetHashPrevBlock().GetHex()));
     result.push_back(Pair("transactions", transactions));
     result.push_back(Pair("coinbaseaux", aux));
     result.push_back(Pair("coinbasevalue", (int64_t)pblock->vtx[0]->vout[0].nValue));
@@ -747,12 +747,12 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         result.push_back(Pair("weightlimit", (int64_t)MAX_BLOCK_WEIGHT));
     }
     result.push_back(Pair("curtime", pblock->GetBlockTime()));
-    result.push_back(Pair("bits", strprintf("%08x", pblock->nBits)));
+    result.push_back(Pair("bits", strprintf("%08x", pblock->GetBits())));
     result.push_back(Pair("height", (int64_t)(pindexPrev->nHeight+1)));
 
-    if (pblock->nMajorVersion != CBlock::BITCOIN_MAJOR_VERSION)
+    if (pblock->GetMajorVersion() != CBlock::BITCOIN_MAJOR_VERSION)
     {
-        result.push_back(Pair("default_witness_merkle_root", pblock->hashWitnessMerkleRoot.GetHex()));
+        result.push_back(Pair("default_witness_merkle_root", pblock->GetHashWitnessMerkleRoot().GetHex()));
     }
     else if (!pblocktemplate->vchCoinbaseCommitment.empty() && fSupportsSegwit)
     {
@@ -834,7 +834,7 @@ UniValue submitblock(const JSONRPCRequest& request)
 
     {
         LOCK(cs_main);
-        BlockMap::iterator mi = mapBlockIndex.find(block.hashPrevBlock);
+        BlockMap::iterator mi = mapBlockIndex.find(block.GetHashPrevBlock());
         if (mi != mapBlockIndex.end()) {
             UpdateUncommittedBlockStructures(block, mi->second, Params().GetConsensus());
         }
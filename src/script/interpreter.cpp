@@ -1126,20 +1126,13 @@ uint256 GetOutputsHash(const CTransaction& txTo) {
     return ss.GetHash();
 }
 
-} // namespace
-
-PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
-{
-    // Cache is calculated only for transactions with witness
-    if (txTo.HasWitness()) {
-        hashPrevouts = GetPrevoutHash(txTo);
-        hashSequence = GetSequenceHash(txTo);
-        hashOutputs = GetOutputsHash(txTo);
-        ready = true;
-    }
-}
-
-uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
+/**
+ * Serialize the message that is signed for input nIn (the signature hash
+ * preimage) into s. Returns false without writing anything for SIGHASH_SINGLE
+ * without a matching output, whose message is the constant 1.
+ */
+template <typename S>
+bool SerializeSignatureMessage(S& ss, const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
 {
     assert(nIn < txTo.vin.size());
 
@@ -1162,12 +1155,11 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
         if ((nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
             hashOutputs = cacheready ? cache->hashOutputs : GetOutputsHash(txTo);
         } else if ((nHashType & 0x1f) == SIGHASH_SINGLE && nIn < txTo.vout.size()) {
-            CHashWriter ss(SER_GETHASH, 0);
-            ss << txTo.vout[nIn];
-            hashOutputs = ss.GetHash();
+            CHashWriter hw(SER_GETHASH, 0);
+            hw << txTo.vout[nIn];
+            hashOutputs = hw.GetHash();
         }
 
-        CHashWriter ss(SER_GETHASH, 0);
         // Version
         ss << txTo.nVersion;
         // Input prevouts/nSequence (none/all, depending on flags)
@@ -1187,106 +1179,81 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
         // Sighash type
         ss << nHashType;
 
-        return ss.GetHash();
+        return true;
     }
 
-    static const uint256 one(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
-
     // Check for invalid use of SIGHASH_SINGLE
     if ((nHashType & 0x1f) == SIGHASH_SINGLE) {
         if (nIn >= txTo.vout.size()) {
             //  nOut out of range
-            return one;
+            return false;
         }
     }
 
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
-    // Serialize and hash
-    CHashWriter ss(SER_GETHASH, 0);
+    // Serialize
     ss << txTmp << nHashType;
-    return ss.GetHash();
+    return true;
 }
 
-CDataStream Signature(const CScript& scriptCode, 
-	const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
-{
-    assert(nIn < txTo.vin.size());
-
-    if (sigversion == SIGVERSION_WITNESS_V0 || sigversion == SIGVERSION_WITNESS_V1) 
-    {
-        uint256 hashPrevouts;
-        uint256 hashSequence;
-        uint256 hashOutputs;
-        const bool cacheready = cache && cache->ready;
-
-        if (!(nHashType & SIGHASH_ANYONECANPAY)) {
-            hashPrevouts = cacheready ? cache->hashPrevouts : GetPrevoutHash(txTo);
-        }
-
-        if (!(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
-            hashSequence = cacheready ? cache->hashSequence : GetSequenceHash(txTo);
-        }
-
+const uint256 SIGHASH_ONE(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
 
-        if ((nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
-            hashOutputs = cacheready ? cache->hashOutputs : GetOutputsHash(txTo);
-        } else if ((nHashType & 0x1f) == SIGHASH_SINGLE && nIn < txTo.vout.size()) {
-            CHashWriter ss(SER_GETHASH, 0);
-            ss << txTo.vout[nIn];
-            hashOutputs = ss.GetHash();
-        }
-
-		CDataStream ss(SER_GETHASH, 0);
-		
-        // Version
-        ss << txTo.nVersion;
-        // Input prevouts/nSequence (none/all, depending on flags)
-        ss << hashPrevouts;
-        ss << hashSequence;
-        // The input being signed (replacing the scriptSig with scriptCode + amount)
-        // The prevout may already be contained in hashPrevout, and the nSequence
-        // may already be contain in hashSequence.
-        ss << txTo.vin[nIn].prevout;
-        ss << scriptCode;
-        ss << amount;
-        ss << txTo.vin[nIn].nSequence;
-        // Outputs (none/one/all, depending on flags)
-        ss << hashOutputs;
-        // Locktime
-        ss << txTo.nLockTime;
-        // Sighash type
-        ss << nHashType;
+} // namespace
 
-        return ss;
+PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
+{
+    // Cache is calculated only for transactions with witness
+    if (txTo.HasWitness()) {
+        hashPrevouts = GetPrevoutHash(txTo);
+        hashSequence = GetSequenceHash(txTo);
+        hashOutputs = GetOutputsHash(txTo);
+        ready = true;
     }
+}
 
-	CDataStream ss(SER_GETHASH, 0);
-	
-    // Check for invalid use of SIGHASH_SINGLE
-    if ((nHashType & 0x1f) == SIGHASH_SINGLE) {
-        if (nIn >= txTo.vout.size()) {
-            //  nOut out of range
-			unsigned char one = 1;
-			ss << one;
-			return ss;
-        }
-    }
+uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    if (!SerializeSignatureMessage(ss, scriptCode, txTo, nIn, nHashType, amount, sigversion, cache))
+        return SIGHASH_ONE;
+    return ss.GetHash();
+}
 
-    // Wrapper to serialize only the necessary parts of the transaction being signed
-    CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
+CDataStream Signature(const CScript& scriptCode, 
+	const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
+{
+	CDataStream ss(SER_GETHASH, 0);
+	if (!SerializeSignatureMessage(ss, scriptCode, txTo, nIn, nHashType, amount, sigversion, cache))
+	{
+		unsigned char one = 1;
+		ss << one;
+	}
+	return ss;
+}
 
-    // Serialize and hash
-    ss << txTmp << nHashType;
-    return ss;
+uint256 SignatureMessage(std::vector<unsigned char>& msg, const CScript& scriptCode,
+	const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
+{
+	msg.clear();
+	CVectorWriter ss(SER_GETHASH, 0, msg, 0);
+	if (!SerializeSignatureMessage(ss, scriptCode, txTo, nIn, nHashType, amount, sigversion, cache))
+	{
+		msg.assign(1, 1);
+		return SIGHASH_ONE;
+	}
+	return Hash(msg.begin(), msg.end());
 }
 
 bool TransactionSignatureChecker::VerifySignature(
 	const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, 
-	CDataStream const & msg) const
+	const std::vector<unsigned char>& msg, const uint256& msghash) const
 {
-    return pubkey.Verify(msg, vchSig);
+	// XMSS signs the message itself, ECDSA its double-SHA256
+	if (pubkey.IsXMSS())
+		return pubkey.Verify(msg.data(), msg.size(), vchSig);
+	return pubkey.VerifyHash(msghash, vchSig);
 }
 
 bool TransactionSignatureChecker::VerifySignatureHash(
@@ -1308,10 +1275,16 @@ bool TransactionSignatureChecker::CheckSig(const std::vector<unsigned char>& vch
     int nHashType = vchSig.back();
     vchSig.pop_back();
 
-    //uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->txdata);
-	CDataStream msg = Signature(scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->txdata);
+    // Signatures of one CHECKMULTISIG (and repeated CHECKSIGs over the same
+    // code) share their message, so only rebuild it when something changed.
+    if (nHashType != m_msgHashType || sigversion != m_msgSigVersion || scriptCode != m_msgScriptCode) {
+        m_msgHash = SignatureMessage(m_msg, scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->txdata);
+        m_msgHashType = nHashType;
+        m_msgSigVersion = sigversion;
+        m_msgScriptCode = scriptCode;
+    }
 
-    if (!VerifySignature(vchSig, pubkey, msg))
+    if (!VerifySignature(vchSig, pubkey, m_msg, m_msgHash))
         return false;
 
     return true;
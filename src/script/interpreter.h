@@ -136,6 +136,12 @@ enum SigVersion
 uint256 SignatureHash(const CScript & scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache = nullptr);
 CDataStream Signature(const CScript & scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache = nullptr);
 
+/**
+ * Write the signed message of input nIn into msg, reusing its capacity, and
+ * return its double-SHA256 (the value SignatureHash returns for it).
+ */
+uint256 SignatureMessage(std::vector<unsigned char>& msg, const CScript & scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache = nullptr);
+
 class BaseSignatureChecker
 {
 public:
@@ -165,9 +171,17 @@ private:
     const CAmount amount;
     const PrecomputedTransactionData* txdata;
 
+    //! Message of the last checked signature and what it was built from
+    mutable std::vector<unsigned char> m_msg;
+    mutable uint256 m_msgHash;
+    mutable CScript m_msgScriptCode;
+    mutable int m_msgHashType = -1;
+    mutable SigVersion m_msgSigVersion = SIGVERSION_BASE;
+
 protected:
 	
-    virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, CDataStream const & msg) const;
+    //! msghash is the double-SHA256 of msg, as returned by SignatureMessage
+    virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const std::vector<unsigned char>& msg, const uint256& msghash) const;
     virtual bool VerifySignatureHash(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
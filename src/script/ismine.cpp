@@ -63,6 +63,11 @@ isminetype IsMine(const CKeyStore &keystore, const CScript& scriptPubKey, bool&
 {
     isInvalid = false;
 
+    // Most scripts seen while scanning are not ours, reject them before running
+    // Solver. Witness recursion is left alone as it may have to flag isInvalid.
+    if (sigversion == SIGVERSION_BASE && !keystore.MayOwnScript(scriptPubKey))
+        return ISMINE_NO;
+
     std::vector<valtype> vSolutions;
     txnouttype whichType;
     if (!Solver(scriptPubKey, whichType, vSolutions)) {
@@ -13,6 +13,7 @@
 #include <util.h>
 
 #include <cuckoocache.h>
+#include <atomic>
 #include <boost/thread.hpp>
 
 namespace {
@@ -30,6 +31,12 @@ private:
     map_type setValid;
     boost::shared_mutex cs_sigcache;
 
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+    std::atomic<uint64_t> nInserts{0};
+    std::atomic<uint64_t> nEvictions{0};
+    size_t nElements = 0;
+
 public:
     CSignatureCache()
     {
@@ -46,17 +53,30 @@ public:
     Get(const uint256& entry, const bool erase)
     {
         boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        bool found = setValid.contains(entry, erase);
+        ++(found ? nHits : nMisses);
+        return found;
     }
 
     void Set(uint256& entry)
     {
         boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        ++nInserts;
+        nEvictions += setValid.insert(entry);
     }
     uint32_t setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        nElements = setValid.setup_bytes(n);
+        return nElements;
+    }
+
+    void GetStats(SignatureCacheStats& stats) const
+    {
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+        stats.nInserts = nInserts;
+        stats.nEvictions = nEvictions;
+        stats.nMaxElements = nElements;
     }
 };
 
@@ -67,6 +87,17 @@ public:
  * signatureCache could be made local to VerifySignature.
 */
 static CSignatureCache signatureCache;
+
+/* XMSS results get a cache of their own. A miss costs a full hash tree
+ * verification instead of one ECDSA verification, so these entries must not be
+ * pushed out by the much cheaper ECDSA ones under mempool churn.
+ */
+static CSignatureCache xmssSignatureCache;
+
+CSignatureCache& GetSignatureCache(const CPubKey& pubkey)
+{
+    return pubkey.IsXMSS() ? xmssSignatureCache : signatureCache;
+}
 } // namespace
 
 // To be called once in AppInitMain/BasicTestingSetup to initialize the
@@ -76,21 +107,30 @@ void InitSignatureCache()
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
-    size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
-    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+    size_t nXMSSCacheSize = nMaxCacheSize / 100 * XMSS_SIG_CACHE_PERCENT;
+    size_t nElems = signatureCache.setup_bytes(nMaxCacheSize - nXMSSCacheSize);
+    size_t nXMSSElems = xmssSignatureCache.setup_bytes(nXMSSCacheSize);
+    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu ECDSA and %zu XMSS elements\n",
+            ((nElems + nXMSSElems)*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems, nXMSSElems);
 }
 
-bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, CDataStream const & msg) const
+void GetSignatureCacheStats(SignatureCacheStats& ecdsa, SignatureCacheStats& xmss)
 {
+    signatureCache.GetStats(ecdsa);
+    xmssSignatureCache.GetStats(xmss);
+}
+
+bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const std::vector<unsigned char>& msg, const uint256& msghash) const
+{
+    CSignatureCache& cache = GetSignatureCache(pubkey);
     uint256 entry;
-    signatureCache.ComputeEntry(entry, Hash(msg.begin(), msg.end()), vchSig, pubkey);
-    if (signatureCache.Get(entry, !store))
+    cache.ComputeEntry(entry, msghash, vchSig, pubkey);
+    if (cache.Get(entry, !store))
         return true;
-    if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, msg))
+    if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, msg, msghash))
         return false;
     if (store)
-        signatureCache.Set(entry);
+        cache.Set(entry);
     return true;
 }
 
@@ -17,6 +17,10 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Share of the signature cache reserved for XMSS signatures, in percent. The
+// cuckoo cache has no per-entry cost, so verification cost is weighted by
+// giving the expensive XMSS entries a partition of their own.
+static const unsigned int XMSS_SIG_CACHE_PERCENT = 75;
 
 class CPubKey;
 
@@ -49,10 +53,23 @@ private:
 public:
     CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn) {}
 
-    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, CDataStream const & msg) const override;
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const std::vector<unsigned char>& msg, const uint256& msghash) const override;
     bool VerifySignatureHash(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
+struct SignatureCacheStats
+{
+    uint64_t nHits = 0;
+    uint64_t nMisses = 0;
+    uint64_t nInserts = 0;
+    //! Valid entries the cache gave up on to make room for new ones
+    uint64_t nEvictions = 0;
+    size_t nMaxElements = 0;
+};
+
 void InitSignatureCache();
 
+/** Counters of the ECDSA and XMSS signature caches since startup. */
+void GetSignatureCacheStats(SignatureCacheStats& ecdsa, SignatureCacheStats& xmss);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
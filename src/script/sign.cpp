@@ -12,7 +12,10 @@
 #include <primitives/transaction.h>
 #include <script/standard.h>
 #include <uint256.h>
+#include <util.h>
 
+#include <atomic>
+#include <thread>
 
 typedef std::vector<unsigned char> valtype;
 
@@ -31,9 +34,10 @@ bool TransactionSignatureCreator::CreateSig(
 	const CScript& scriptCode, 
 	SigVersion sigversion) const
 {
-    CKey key;
-	if (!keystore->GetKey(address, key))
+    std::shared_ptr<const CKey> pkey = keystore->GetKeyHandle(address);
+	if (!pkey)
         return false;
+    const CKey& key = *pkey;
 
     // Signing with uncompressed keys is disabled in witness scripts
 	if (sigversion == SIGVERSION_WITNESS_V0 && !is_key_segwit_useable(key))
@@ -98,6 +102,187 @@ const BaseSignatureChecker& TransactionSignatureCounter::Checker() const
 }
 
 
+namespace {
+/** An XMSS signature to make, with its message and reserved leaf index */
+struct XMSSSignJob
+{
+    unsigned int nIn;
+    CKeyID keyid;
+    std::vector<unsigned char> msg;
+    uint64_t nIndex;
+    size_t nTxoCount;
+    std::vector<unsigned char> vchSig;
+};
+
+/**
+ * Records the XMSS signatures an input needs instead of making them, see
+ * SignTransactionInputs(). Keys are fetched once per transaction.
+ */
+class XMSSSignatureCollector : public BaseSignatureCreator
+{
+    const CTransaction* txTo;
+    const PrecomputedTransactionData& txdata;
+    unsigned int nIn;
+    int nHashType;
+    CAmount amount;
+    std::map<CKeyID, std::shared_ptr<const CKey> >& mapKeys;
+    std::vector<XMSSSignJob>& vJobs;
+
+public:
+    XMSSSignatureCollector(CKeyStore* keystoreIn, const CTransaction* txToIn, const PrecomputedTransactionData& txdataIn,
+            unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn,
+            std::map<CKeyID, std::shared_ptr<const CKey> >& mapKeysIn, std::vector<XMSSSignJob>& vJobsIn)
+        : BaseSignatureCreator(keystoreIn), txTo(txToIn), txdata(txdataIn), nIn(nInIn), nHashType(nHashTypeIn),
+          amount(amountIn), mapKeys(mapKeysIn), vJobs(vJobsIn) {}
+
+    const BaseSignatureChecker& Checker() const override { return dummyChecker; }
+
+    bool CreateSig(std::vector<unsigned char>& vchSig, const CKeyID& address, const CScript& scriptCode, SigVersion sigversion) const override
+    {
+        auto it = mapKeys.find(address);
+        if (it == mapKeys.end()) {
+            std::shared_ptr<const CKey> pkey = keystore->GetKeyHandle(address);
+            if (!pkey)
+                return false;
+            it = mapKeys.emplace(address, std::move(pkey)).first;
+        }
+
+        // other keys are signed in place by the second pass
+        if (it->second->IsXMSS()) {
+            CDataStream msg = Signature(scriptCode, *txTo, nIn, nHashType, amount, sigversion, &txdata);
+            uint64_t nIndex = keystore->GetKeyUseCountInc(address);
+            // a plain key store only counts a key once a use count is set
+            keystore->SetKeyUseCount(address, nIndex + 1);
+            vJobs.push_back(XMSSSignJob{nIn, address, std::vector<unsigned char>(msg.begin(), msg.end()), nIndex, keystore->GetKeyTxoCount(address), {}});
+        }
+        vchSig.push_back((unsigned char)nHashType);
+        return true;
+    }
+};
+
+/** Hands out the XMSS signatures made by SignTransactionInputs() for one input */
+class PrecomputedSignatureCreator : public TransactionSignatureCreator
+{
+    const std::map<CKeyID, std::vector<unsigned char> >& mapSigs;
+
+public:
+    PrecomputedSignatureCreator(CKeyStore* keystoreIn, const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn,
+            int nHashTypeIn, const std::map<CKeyID, std::vector<unsigned char> >& mapSigsIn)
+        : TransactionSignatureCreator(keystoreIn, txToIn, nInIn, amountIn, nHashTypeIn), mapSigs(mapSigsIn) {}
+
+    bool CreateSig(std::vector<unsigned char>& vchSig, const CKeyID& address, const CScript& scriptCode, SigVersion sigversion) const override
+    {
+        auto it = mapSigs.find(address);
+        if (it == mapSigs.end())
+            return TransactionSignatureCreator::CreateSig(vchSig, address, scriptCode, sigversion);
+        vchSig = it->second;
+        return true;
+    }
+};
+} // namespace
+
+bool SignTransactionInputs(CKeyStore& keystore, CMutableTransaction& tx, const std::vector<CTxOut>& vSpent, int nHashType, unsigned int nThreads)
+{
+    assert(vSpent.size() == tx.vin.size());
+    const CTransaction txConst(tx);
+    const PrecomputedTransactionData txdata(txConst);
+
+    std::map<CKeyID, std::shared_ptr<const CKey> > mapKeys;
+    std::vector<XMSSSignJob> vJobs;
+    for (unsigned int nIn = 0; nIn < txConst.vin.size(); nIn++) {
+        SignatureData sigdata;
+        ProduceSignature(XMSSSignatureCollector(&keystore, &txConst, txdata, nIn, vSpent[nIn].nValue, nHashType, mapKeys, vJobs), vSpent[nIn].scriptPubKey, sigdata);
+    }
+
+    if (nThreads == 0)
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    nThreads = std::max(1u, std::min<unsigned int>(nThreads, vJobs.size()));
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> fFailed(false);
+    auto worker = [&]() {
+        for (size_t i = next++; i < vJobs.size() && !fFailed; i = next++) {
+            XMSSSignJob& job = vJobs[i];
+            try {
+                if (!mapKeys.find(job.keyid)->second->SignXMSS(job.msg.data(), job.msg.size(), job.nIndex, job.nTxoCount, job.vchSig))
+                    fFailed = true;
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+                fFailed = true;
+            }
+            job.vchSig.push_back((unsigned char)nHashType);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+    for (unsigned int i = 1; i < nThreads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+    if (fFailed)
+        return false;
+
+    std::vector<std::map<CKeyID, std::vector<unsigned char> > > vSigs(txConst.vin.size());
+    for (XMSSSignJob& job : vJobs)
+        vSigs[job.nIn][job.keyid] = std::move(job.vchSig);
+
+    for (unsigned int nIn = 0; nIn < txConst.vin.size(); nIn++) {
+        SignatureData sigdata;
+        if (!ProduceSignature(PrecomputedSignatureCreator(&keystore, &txConst, nIn, vSpent[nIn].nValue, nHashType, vSigs[nIn]), vSpent[nIn].scriptPubKey, sigdata))
+            return false;
+        UpdateTransaction(tx, nIn, sigdata);
+    }
+    return true;
+}
+
+bool ExtractXMSSSignatures(const CScriptWitness& witness, std::vector<std::pair<CPubKey, int64_t> >& vSigsRet)
+{
+    vSigsRet.clear();
+    if (witness.stack.empty())
+        return true;
+
+    // a version 1 witness ends with the witness script, the signatures come before it
+    const valtype& vchScript = witness.stack.back();
+    CScript witnessScript(vchScript.begin(), vchScript.end());
+    txnouttype whichType;
+    std::vector<valtype> vSolutions;
+    std::vector<std::pair<const valtype*, const valtype*> > vPairs;
+    bool fMatched = false;
+    if (Solver(witnessScript, whichType, vSolutions)) {
+        if (whichType == TX_PUBKEY && witness.stack.size() == 2) {
+            vPairs.emplace_back(&vSolutions[0], &witness.stack[0]);
+            fMatched = true;
+        } else if (whichType == TX_MULTISIG && witness.stack.size() == vSolutions.size()) {
+            // dummy, one signature per key and the script: signatures are in key order
+            for (size_t i = 1; i + 1 < vSolutions.size(); i++)
+                vPairs.emplace_back(&vSolutions[i], &witness.stack[i]);
+            fMatched = true;
+        }
+    }
+
+    if (!fMatched) {
+        for (const valtype& item : witness.stack) {
+            if (xmss_is_der_signature(item))
+                return false;
+        }
+        return true;
+    }
+
+    for (const auto& pair : vPairs) {
+        if (!xmss_is_der_pubkey(*pair.first) || pair.second->empty())
+            continue;
+        // strip the hash type like the script interpreter does
+        valtype vchSig(pair.second->begin(), pair.second->end() - 1);
+        int64_t nIndex = xmss_get_use_count_from_der_sig(vchSig);
+        if (nIndex < 0)
+            continue;
+        vSigsRet.emplace_back(CPubKey(*pair.first), nIndex);
+    }
+    return true;
+}
+
 static bool Sign1(const CKeyID& address, const BaseSignatureCreator& creator,
         const CScript& scriptCode, std::vector<valtype>& ret, SigVersion sigversion)
 {
@@ -515,8 +700,14 @@ bool DummySignatureCreator::CreateSig(std::vector<unsigned char>& vchSig,
         return ecdsa_create_dummy_der_signature(vchSig);
 
     case SIGVERSION_WITNESS_V1:
+    {
+        // XMSS signatures grow with the tree height of the key
+        CPubKey pubkey;
+        if (keystore->GetPubKey(keyid, pubkey) && pubkey.IsXMSS())
+            return xmss_create_dummy_der_signature(vchSig, pubkey.GetKeyType());
         return xmss_create_dummy_der_signature(vchSig);
     }
+    }
 
     return false;
 }
@@ -13,6 +13,7 @@ class CKeyID;
 class CKeyStore;
 class CScript;
 class CTransaction;
+class CTxOut;
 
 struct CMutableTransaction;
 
@@ -53,7 +54,8 @@ public:
     MutableTransactionSignatureCreator(CKeyStore* keystoreIn, const CMutableTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn) : TransactionSignatureCreator(keystoreIn, &tx, nInIn, amountIn, nHashTypeIn), tx(*txToIn) {}
 };
 
-/** A signature creator that just produces 72-byte empty signatures. */
+/** A signature creator that just produces 72-byte empty ECDSA signatures, and
+ *  empty XMSS signatures of the size the key's tree height gives. */
 class DummySignatureCreator : public BaseSignatureCreator {
 public:
     explicit DummySignatureCreator(const CKeyStore* keystoreIn) 
@@ -91,6 +93,24 @@ bool ProduceSignature(const BaseSignatureCreator& creator, const CScript& script
 bool SignSignature(CKeyStore & keystore, const CScript& fromPubKey, CMutableTransaction& txTo, unsigned int nIn, const CAmount& amount, int nHashType);
 bool SignSignature(CKeyStore & keystore, const CTransaction& txFrom, CMutableTransaction& txTo, unsigned int nIn, int nHashType);
 
+/**
+ * Sign all inputs of tx, which spend vSpent. XMSS signatures are made on up to
+ * nThreads threads (0 = one per core): the inputs are first walked in order to
+ * compute their signature messages and reserve leaf indices, then the
+ * signatures are made in parallel and placed into the inputs.
+ * Returns false if an input could not be signed.
+ */
+bool SignTransactionInputs(CKeyStore& keystore, CMutableTransaction& tx, const std::vector<CTxOut>& vSpent, int nHashType, unsigned int nThreads);
+
+/**
+ * Read the XMSS public keys and signature leaf indices of an input from its
+ * witness without evaluating the script. Witness scripts with a single key
+ * and fully signed multisig scripts are recognised. Returns false if the
+ * witness holds XMSS signatures that only running the script can match to
+ * their keys.
+ */
+bool ExtractXMSSSignatures(const CScriptWitness& witness, std::vector<std::pair<CPubKey, int64_t> >& vSigsRet);
+
 /** Combine two script signatures using a generic signature checker, intelligently, possibly with OP_0 placeholders. */
 SignatureData CombineSignatures(const CScript& scriptPubKey, const BaseSignatureChecker& checker, const SignatureData& scriptSig1, const SignatureData& scriptSig2);
 
@@ -0,0 +1,198 @@
+// Copyright (c) 2018 The Bitcoin Post-Quantum developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Hands out small blocks carved from large chunks, and keeps freed blocks in
+ * one free list per size for reuse, instead of a malloc per block.
+ *
+ * Blocks of up to MAX_BLOCK_SIZE_BYTES with an alignment of at most
+ * ALIGN_BYTES come from the pool, anything else is passed on to operator new.
+ * Chunks are only returned to the system when the resource is destroyed.
+ * Not thread safe.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource
+{
+    static_assert(ALIGN_BYTES > 0 && (ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+    static_assert(MAX_BLOCK_SIZE_BYTES % ALIGN_BYTES == 0, "MAX_BLOCK_SIZE_BYTES must be a multiple of ALIGN_BYTES");
+
+    struct ListNode {
+        ListNode* next;
+    };
+    static_assert(ALIGN_BYTES >= sizeof(ListNode), "Free blocks must be able to hold a ListNode");
+
+    static const std::size_t CHUNK_SIZE_BYTES = 256 * 1024;
+
+    //! Free lists, indexed by block size in units of ALIGN_BYTES.
+    std::array<ListNode*, MAX_BLOCK_SIZE_BYTES / ALIGN_BYTES + 1> m_free_lists;
+    std::vector<std::unique_ptr<char[]> > m_chunks;
+    char* m_available_begin;
+    char* m_available_end;
+    //! Bytes in blocks which are handed out from the pool.
+    std::size_t m_used_bytes;
+
+    static std::size_t NumAlignUnits(std::size_t bytes)
+    {
+        return (bytes + ALIGN_BYTES - 1) / ALIGN_BYTES;
+    }
+
+    static bool IsPooled(std::size_t bytes, std::size_t alignment)
+    {
+        return bytes > 0 && bytes <= MAX_BLOCK_SIZE_BYTES && alignment <= ALIGN_BYTES;
+    }
+
+    void PushFree(char* p, std::size_t units)
+    {
+        ListNode* node = new (p) ListNode;
+        node->next = m_free_lists[units];
+        m_free_lists[units] = node;
+    }
+
+    void AllocateChunk()
+    {
+        // Keep what is left of the current chunk for blocks of its size
+        std::size_t remaining_units = (m_available_end - m_available_begin) / ALIGN_BYTES;
+        if (remaining_units > 0)
+            PushFree(m_available_begin, remaining_units);
+
+        m_chunks.emplace_back(new char[CHUNK_SIZE_BYTES]);
+        m_available_begin = m_chunks.back().get();
+        m_available_end = m_available_begin + CHUNK_SIZE_BYTES;
+    }
+
+public:
+    PoolResource() : m_available_begin(nullptr), m_available_end(nullptr), m_used_bytes(0)
+    {
+        m_free_lists.fill(nullptr);
+    }
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    void* Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (!IsPooled(bytes, alignment))
+            return ::operator new(bytes);
+
+        std::size_t units = NumAlignUnits(bytes);
+        m_used_bytes += units * ALIGN_BYTES;
+        if (m_free_lists[units]) {
+            ListNode* node = m_free_lists[units];
+            m_free_lists[units] = node->next;
+            return node;
+        }
+        if (static_cast<std::size_t>(m_available_end - m_available_begin) < units * ALIGN_BYTES)
+            AllocateChunk();
+        char* p = m_available_begin;
+        m_available_begin += units * ALIGN_BYTES;
+        return p;
+    }
+
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (!IsPooled(bytes, alignment)) {
+            ::operator delete(p);
+            return;
+        }
+
+        std::size_t units = NumAlignUnits(bytes);
+        m_used_bytes -= units * ALIGN_BYTES;
+        PushFree(static_cast<char*>(p), units);
+    }
+
+    //! Bytes handed out from the pool; freed blocks are reused before new chunks are allocated.
+    std::size_t UsedBytes() const { return m_used_bytes; }
+
+    //! Bytes of all chunks allocated so far.
+    std::size_t ChunkBytes() const { return m_chunks.size() * CHUNK_SIZE_BYTES; }
+
+    //! Bytes of freed blocks waiting to be reused, not counting the untouched end of the last chunk.
+    std::size_t FreeBytes() const { return ChunkBytes() - m_used_bytes - (m_available_end - m_available_begin); }
+};
+
+/**
+ * Allocator drawing from a PoolResource, for node based containers whose
+ * nodes all have the same size, such as std::unordered_map.
+ *
+ * Every default constructed allocator creates its own resource, which all
+ * copies (and rebound copies) share, so each container gets a pool of its
+ * own. A container copy gets a new pool as well; on move and swap the pool
+ * goes along with the elements.
+ */
+template <class T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(void*)>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+    typedef PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> ResourceType;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <class U>
+    struct rebind {
+        typedef PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> other;
+    };
+
+    PoolAllocator() : m_resource(std::make_shared<ResourceType>()) {}
+
+    // No move constructor: a container moved from keeps sharing the pool, and stays usable.
+    PoolAllocator(const PoolAllocator& other) noexcept : m_resource(other.m_resource) {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : m_resource(other.m_resource) {}
+
+    PoolAllocator& operator=(const PoolAllocator& other) noexcept
+    {
+        m_resource = other.m_resource;
+        return *this;
+    }
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    PoolAllocator select_on_container_copy_construction() const
+    {
+        return PoolAllocator();
+    }
+
+    const ResourceType& resource() const { return *m_resource; }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) const
+    {
+        return m_resource == other.m_resource;
+    }
+
+    template <class U>
+    bool operator!=(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    template <class U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+    std::shared_ptr<ResourceType> m_resource;
+};
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
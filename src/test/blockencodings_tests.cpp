@@ -14,10 +14,6 @@
 
 std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
 
-struct RegtestingSetup : public TestingSetup {
-    RegtestingSetup() : TestingSetup(CBaseChainParams::REGTEST) {}
-};
-
 BOOST_FIXTURE_TEST_SUITE(blockencodings_tests, RegtestingSetup)
 
 static CBlock BuildBlockTestCase() {
@@ -30,9 +26,9 @@ static CBlock BuildBlockTestCase() {
     
     block.vtx.resize(3);
     block.vtx[0] = MakeTransactionRef(tx);
-    block.nMinorVersion = 42;
-    block.hashPrevBlock = InsecureRand256();
-    block.nBits = 0x207fffff;
+    block.SetMinorVersion(42);
+    block.SetHashPrevBlock(InsecureRand256());
+    block.SetBits(0x207fffff);
     
     tx.vin[0].prevout.hash = InsecureRand256();
     tx.vin[0].prevout.n = 0;
@@ -46,11 +42,11 @@ static CBlock BuildBlockTestCase() {
     block.vtx[2] = MakeTransactionRef(tx);
     
     bool mutated;
-    block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
+    block.SetHashMerkleRoot(BlockMerkleRoot(block, &mutated));
     assert(!mutated);
     // TODO(h4x3rotab): Generate Equihash solution if applicable.
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, false, Params().GetConsensus())) {
-        block.nNonce = ArithToUint256(UintToArith256(block.nNonce) + 1);
+    while (!CheckProofOfWork(block.GetHash(), block.GetBits(), false, Params().GetConsensus())) {
+        block.SetNonce(ArithToUint256(UintToArith256(block.GetNonce()) + 1));
     }
     return block;
 }
@@ -104,12 +100,12 @@ BOOST_AUTO_TEST_CASE(SimpleRoundTripTest)
             partialBlock = tmp;
         }
         bool mutated;
-        BOOST_CHECK(block.hashMerkleRoot != BlockMerkleRoot(block2, &mutated));
+        BOOST_CHECK(block.GetHashMerkleRoot() != BlockMerkleRoot(block2, &mutated));
         
         CBlock block3;
         BOOST_CHECK(partialBlock.FillBlock(block3, {block.vtx[1]}) == READ_STATUS_OK);
         BOOST_CHECK_EQUAL(block.GetHash().ToString(), block3.GetHash().ToString());
-        BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block3, &mutated).ToString());
+        BOOST_CHECK_EQUAL(block.GetHashMerkleRoot().ToString(), BlockMerkleRoot(block3, &mutated).ToString());
         BOOST_CHECK(!mutated);
     }
 }
@@ -207,13 +203,13 @@ BOOST_AUTO_TEST_CASE(NonCoinbasePreforwardRTTest)
             partialBlock = tmp;
         }
         bool mutated;
-        BOOST_CHECK(block.hashMerkleRoot != BlockMerkleRoot(block2, &mutated));
+        BOOST_CHECK(block.GetHashMerkleRoot() != BlockMerkleRoot(block2, &mutated));
 
         CBlock block3;
         PartiallyDownloadedBlock partialBlockCopy = partialBlock;
         BOOST_CHECK(partialBlock.FillBlock(block3, {block.vtx[0]}) == READ_STATUS_OK);
         BOOST_CHECK_EQUAL(block.GetHash().ToString(), block3.GetHash().ToString());
-        BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block3, &mutated).ToString());
+        BOOST_CHECK_EQUAL(block.GetHashMerkleRoot().ToString(), BlockMerkleRoot(block3, &mutated).ToString());
         BOOST_CHECK(!mutated);
 
         txhash = block.vtx[2]->GetHash();
@@ -265,7 +261,7 @@ BOOST_AUTO_TEST_CASE(SufficientPreforwardRTTest)
         BOOST_CHECK(partialBlock.FillBlock(block2, {}) == READ_STATUS_OK);
         BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
         bool mutated;
-        BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block2, &mutated).ToString());
+        BOOST_CHECK_EQUAL(block.GetHashMerkleRoot().ToString(), BlockMerkleRoot(block2, &mutated).ToString());
         BOOST_CHECK(!mutated);
 
         txhash = block.vtx[1]->GetHash();
@@ -288,17 +284,17 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     CBlock block;
     block.vtx.resize(1);
     block.vtx[0] = MakeTransactionRef(std::move(coinbase));
-    block.nMinorVersion = 42;
-    block.hashPrevBlock = InsecureRand256();
-    block.nBits = 0x207fffff;
+    block.SetMinorVersion(42);
+    block.SetHashPrevBlock(InsecureRand256());
+    block.SetBits(0x207fffff);
 
     bool mutated;
-    block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
+    block.SetHashMerkleRoot(BlockMerkleRoot(block, &mutated));
     assert(!mutated);
         // TODO: Generate Equihash solution if applicable.
     // TODO(h4x3rotab): Generate Equihash solution if applicable.
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, false, Params().GetConsensus())) {
-        block.nNonce = ArithToUint256(UintToArith256(block.nNonce) + 1);
+    while (!CheckProofOfWork(block.GetHash(), block.GetBits(), false, Params().GetConsensus())) {
+        block.SetNonce(ArithToUint256(UintToArith256(block.GetNonce()) + 1));
     }
 
     // Test simple header round-trip with only coinbase
@@ -319,7 +315,7 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
         std::vector<CTransactionRef> vtx_missing;
         BOOST_CHECK(partialBlock.FillBlock(block2, vtx_missing) == READ_STATUS_OK);
         BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
-        BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block2, &mutated).ToString());
+        BOOST_CHECK_EQUAL(block.GetHashMerkleRoot().ToString(), BlockMerkleRoot(block2, &mutated).ToString());
         BOOST_CHECK(!mutated);
     }
 }
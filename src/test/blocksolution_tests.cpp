@@ -0,0 +1,133 @@
+// Copyright (c) 2018 The Bitcoin Post-Quantum developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <pow.h>
+#include <random.h>
+#include <txdb.h>
+#include <validation.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blocksolution_tests, RegtestingSetup)
+
+/* Build a chain of pre-fork headers on the regtest genesis block. Their
+ * solutions are not checked, so random bytes tell them apart. */
+static std::vector<CBlockHeader> CreateHeaders(size_t nCount)
+{
+    const CChainParams& params = Params();
+    std::vector<CBlockHeader> headers;
+    uint256 hashPrev = params.GenesisBlock().GetHash();
+    for (size_t i = 0; i < nCount; i++) {
+        CBlockHeader header;
+        header.SetMajorVersion(CBlockHeader::BITCOIN_MAJOR_VERSION);
+        header.SetMinorVersion(4);
+        header.SetHashPrevBlock(hashPrev);
+        header.SetHashMerkleRoot(InsecureRand256());
+        header.SetTime(params.GenesisBlock().GetBlockTime() + 600 * (i + 1));
+        header.SetBits(params.GenesisBlock().GetBits());
+        header.SetSolution(insecure_rand_ctx.randbytes(params.GetConsensus().nSolutionSize));
+        uint64_t nNonce = 0;
+        do {
+            header.SetNonce(ArithToUint256(arith_uint256(++nNonce)));
+        } while (!CheckProofOfWork(header.GetHash(), header.GetBits(), false, params.GetConsensus()));
+        hashPrev = header.GetHash();
+        headers.push_back(header);
+    }
+    return headers;
+}
+
+/* Overwrite the block tree DB records of vIndex */
+static void WriteSolutions(const std::vector<const CBlockIndex*>& vIndex, const std::vector<std::vector<unsigned char>>& vSolutions)
+{
+    int nLastFile = 0;
+    pblocktree->ReadLastBlockFile(nLastFile);
+    std::vector<CDiskBlockIndex> vBlocks;
+    for (size_t i = 0; i < vIndex.size(); i++)
+        vBlocks.emplace_back(vIndex[i], vSolutions[i]);
+    BOOST_REQUIRE(pblocktree->WriteBatchSync({}, nLastFile, vBlocks));
+}
+
+static void CheckHeaders(const std::vector<const CBlockIndex*>& vIndex, const std::vector<CBlockHeader>& expected)
+{
+    std::vector<CBlockHeader> vHeaders;
+    BOOST_REQUIRE(GetBlockHeaders(vIndex, vHeaders));
+    BOOST_REQUIRE_EQUAL(vHeaders.size(), expected.size());
+    LOCK(cs_main);
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        BOOST_CHECK(vHeaders[i].GetHash() == expected[i].GetHash());
+        BOOST_CHECK(vHeaders[i].GetSolution() == expected[i].GetSolution());
+        CBlockHeader header;
+        BOOST_CHECK(GetBlockHeader(vIndex[i], header));
+        BOOST_CHECK(header.GetHash() == expected[i].GetHash());
+    }
+}
+
+/* Served headers carry their solutions whether these are pinned until the
+ * next flush, kept in the LRU of recent blocks or read from the DB. Records
+ * with other solutions written to the DB show which one was used. */
+BOOST_AUTO_TEST_CASE(block_solution_cache)
+{
+    const CChainParams& params = Params();
+    std::vector<CBlockHeader> headers = CreateHeaders(20);
+    CValidationState state;
+    BOOST_REQUIRE(ProcessNewBlockHeaders(headers, state, params));
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        for (const CBlockHeader& header : headers)
+            vIndex.push_back(mapBlockIndex.at(header.GetHash()));
+    }
+    std::vector<std::vector<unsigned char>> vSolutions;
+    for (const CBlockHeader& header : headers)
+        vSolutions.push_back(header.GetSolution());
+    std::vector<std::vector<unsigned char>> vOtherSolutions(vIndex.size(), std::vector<unsigned char>(params.GetConsensus().nSolutionSize));
+
+    // New entries are not in the DB yet, their solutions are pinned
+    CDiskBlockIndex diskindex;
+    BOOST_CHECK(!pblocktree->ReadBlockIndex(vIndex.back()->GetBlockHash(), diskindex));
+    WriteSolutions(vIndex, vOtherSolutions);
+    CheckHeaders(vIndex, headers);
+
+    // The flush writes them, and keeps those near the best header in the LRU
+    FlushStateToDisk();
+    BOOST_CHECK(pblocktree->ReadBlockIndex(vIndex.back()->GetBlockHash(), diskindex));
+    BOOST_CHECK(diskindex.nSolution == vSolutions.back());
+    WriteSolutions(vIndex, vOtherSolutions);
+    CheckHeaders(vIndex, headers);
+
+    // Reading the solutions of as many other recent blocks evicts them from the LRU
+    std::vector<uint256> vOtherHashes(BLOCK_SOLUTION_CACHE_SIZE);
+    std::vector<CBlockIndex> vOther(BLOCK_SOLUTION_CACHE_SIZE);
+    std::vector<const CBlockIndex*> vOtherIndex;
+    for (size_t i = 0; i < vOther.size(); i++) {
+        vOtherHashes[i] = InsecureRand256();
+        vOther[i].phashBlock = &vOtherHashes[i];
+        vOther[i].nHeight = vIndex.back()->nHeight;
+        vOtherIndex.push_back(&vOther[i]);
+    }
+    WriteSolutions(vOtherIndex, std::vector<std::vector<unsigned char>>(vOther.size(), vSolutions.back()));
+    {
+        LOCK(cs_main);
+        std::vector<unsigned char> solution;
+        for (const CBlockIndex* pindex : vOtherIndex) {
+            BOOST_REQUIRE(GetBlockSolution(pindex, solution));
+            BOOST_CHECK(solution == vSolutions.back());
+        }
+    }
+
+    // Evicted solutions are read from the DB
+    std::vector<CBlockHeader> vHeaders;
+    BOOST_REQUIRE(GetBlockHeaders(vIndex, vHeaders));
+    for (size_t i = 0; i < vHeaders.size(); i++)
+        BOOST_CHECK(vHeaders[i].GetSolution() == vOtherSolutions[i]);
+    WriteSolutions(vIndex, vSolutions);
+    CheckHeaders(vIndex, headers);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
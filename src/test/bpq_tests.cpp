@@ -136,8 +136,8 @@ public:
 			IncrementExtraNonce(&block, chainActive.Tip(), extraNonce);
 		}
 
-		while (!CheckProofOfWork(block.GetHash(), block.nBits, false, chainparams.GetConsensus())) 
-			block.nNonce = ArithToUint256(UintToArith256(block.nNonce) + 1);
+		while (!CheckProofOfWork(block.GetHash(), block.GetBits(), false, chainparams.GetConsensus())) 
+			block.SetNonce(ArithToUint256(UintToArith256(block.GetNonce()) + 1));
 
 		std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
 
@@ -3,8 +3,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
 #include <coins.h>
+#include <policy/policy.h>
 #include <script/standard.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <utilstrencodings.h>
@@ -14,6 +17,7 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 
 #include <boost/test/unit_test.hpp>
 
@@ -856,4 +860,174 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_FIXTURE_TEST_CASE(coins_cache_write_back, TestingSetup)
+{
+    CCoinsViewDB coinsdb(1 << 20, true);
+    CCoinsViewCache cache(&coinsdb);
+
+    std::vector<COutPoint> outpoints;
+    for (uint32_t i = 0; i < 100; i++) {
+        outpoints.emplace_back(InsecureRand256(), i);
+        cache.AddCoin(outpoints.back(), Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false), false);
+    }
+    cache.SetBestBlock(InsecureRand256());
+    size_t nPeakUsage = cache.DynamicMemoryUsage();
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    // The pool of the flushed entries is released
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), cache.EntriesMemoryUsage());
+    BOOST_CHECK(cache.DynamicMemoryUsage() < nPeakUsage);
+
+    // Load the first half, spend a quarter of them and add new coins
+    for (uint32_t i = 0; i < 50; i++)
+        BOOST_CHECK(cache.HaveCoin(outpoints[i]));
+    for (uint32_t i = 0; i < 25; i++)
+        BOOST_CHECK(cache.SpendCoin(outpoints[i]));
+    for (uint32_t i = 100; i < 110; i++) {
+        outpoints.emplace_back(InsecureRand256(), i);
+        cache.AddCoin(outpoints.back(), Coin(CTxOut(i + 1, CScript() << OP_TRUE), 2, false), false);
+    }
+    uint256 hashBlock = InsecureRand256();
+    cache.SetBestBlock(hashBlock);
+
+    // Spent coins leave the cache, the others stay in it, now clean
+    std::shared_ptr<const CCoinsMap> mapCoins = cache.StartWriteBack();
+    BOOST_CHECK(cache.HaveWriteBack());
+    BOOST_CHECK_EQUAL(mapCoins->size(), 35U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 35U);
+    for (uint32_t i = 0; i < 25; i++)
+        BOOST_CHECK(!cache.HaveCoinInCache(outpoints[i]));
+
+    // Before the database has the modifications, evicted coins are read back
+    // from the write back
+    cache.EvictClean(0);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    for (uint32_t i = 0; i < outpoints.size(); i++)
+        BOOST_CHECK_EQUAL(cache.HaveCoin(outpoints[i]), i >= 25);
+    BOOST_CHECK(!coinsdb.HaveCoin(outpoints[105]));
+
+    BOOST_CHECK(coinsdb.WriteCoins(*mapCoins, hashBlock));
+    cache.EndWriteBack();
+    BOOST_CHECK(!cache.HaveWriteBack());
+    BOOST_CHECK(coinsdb.GetBestBlock() == hashBlock);
+    for (uint32_t i = 0; i < outpoints.size(); i++)
+        BOOST_CHECK_EQUAL(coinsdb.HaveCoin(outpoints[i]), i >= 25);
+
+    // Nothing is dirty, the next write back is empty
+    BOOST_CHECK(cache.StartWriteBack()->empty());
+    cache.EndWriteBack();
+
+    // Coins looked up since the previous pass get a second chance
+    cache.EvictClean(0);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    for (uint32_t i = 25; i < 50; i++)
+        BOOST_CHECK(cache.HaveCoin(outpoints[i]));
+    cache.EvictClean(cache.EntriesMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 24U);
+    for (uint32_t i = 25; i < 30; i++)
+        BOOST_CHECK(cache.HaveCoin(outpoints[i]));
+    unsigned int nCacheSize = cache.GetCacheSize();
+    size_t nUsage = cache.DynamicMemoryUsage();
+    cache.EvictClean(cache.EntriesMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), nCacheSize - 1);
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= nUsage);
+    for (uint32_t i = 25; i < 30; i++)
+        BOOST_CHECK(cache.HaveCoinInCache(outpoints[i]));
+
+    // A write back which is not written gives its coins back as modified
+    BOOST_CHECK(cache.SpendCoin(outpoints[30]));
+    cache.AddCoin(COutPoint(InsecureRand256(), 0), Coin(CTxOut(1, CScript() << OP_TRUE), 3, false), false);
+    BOOST_CHECK_EQUAL(cache.StartWriteBack()->size(), 2U);
+    cache.CancelWriteBack();
+    BOOST_CHECK(!cache.HaveWriteBack());
+    BOOST_CHECK(!cache.HaveCoin(outpoints[30]));
+    mapCoins = cache.StartWriteBack();
+    BOOST_CHECK_EQUAL(mapCoins->size(), 2U);
+    BOOST_CHECK(coinsdb.WriteCoins(*mapCoins, hashBlock));
+    cache.EndWriteBack();
+    BOOST_CHECK(!coinsdb.HaveCoin(outpoints[30]));
+
+    // Coins added since the previous pass get a second chance as well
+    cache.EvictClean(0);
+    BOOST_CHECK(cache.HaveCoin(outpoints[31]));
+    BOOST_CHECK(cache.HaveCoin(outpoints[32]));
+    cache.EvictClean(cache.EntriesMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    COutPoint outpointAdded(InsecureRand256(), 0);
+    cache.AddCoin(outpointAdded, Coin(CTxOut(1, CScript() << OP_TRUE), 4, false), false);
+    mapCoins = cache.StartWriteBack();
+    BOOST_CHECK(coinsdb.WriteCoins(*mapCoins, hashBlock));
+    cache.EndWriteBack();
+    cache.EvictClean(cache.EntriesMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    BOOST_CHECK(cache.HaveCoinInCache(outpointAdded));
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_evict_in_place)
+{
+    CCoinsView root;
+    CCoinsViewCache base(&root);
+    std::vector<COutPoint> outpoints;
+    for (uint32_t i = 0; i < 10000; i++) {
+        outpoints.emplace_back(InsecureRand256(), i);
+        base.AddCoin(outpoints.back(), Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false), false);
+    }
+    CCoinsViewCache cache(&base);
+    for (const COutPoint& outpoint : outpoints)
+        cache.HaveCoin(outpoint);
+    size_t nUsage = cache.DynamicMemoryUsage();
+    size_t nEntriesUsage = cache.EntriesMemoryUsage();
+
+    // A small eviction leaves its blocks in the pool, the next entries take them
+    cache.EvictClean((9 * nEntriesUsage) / 10);
+    BOOST_CHECK(cache.GetCacheSize() < outpoints.size());
+    BOOST_CHECK(cache.EntriesMemoryUsage() <= (9 * nEntriesUsage) / 10);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), nUsage);
+    size_t nFound = 0;
+    for (const COutPoint& outpoint : outpoints)
+        nFound += cache.HaveCoin(outpoint);
+    BOOST_CHECK_EQUAL(nFound, outpoints.size());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size());
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), nUsage);
+
+    // Once most of the pool is free it is compacted
+    cache.EvictClean(nEntriesUsage / 4);
+    BOOST_CHECK(cache.DynamicMemoryUsage() < nUsage / 2);
+    size_t nInCache = 0;
+    for (const COutPoint& outpoint : outpoints)
+        nInCache += cache.HaveCoinInCache(outpoint);
+    BOOST_CHECK_EQUAL(nInCache, cache.GetCacheSize());
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_write_back_flush, TestChain100Setup)
+{
+    const CChainParams& chainparams = Params();
+    CValidationState state;
+    size_t nCoinCacheUsageOld = nCoinCacheUsage;
+    fCoinsWriteBack = true;
+    gArgs.ForceSetArg("-maxmempool", "0");
+    LOCK(cs_main);
+
+    // A periodic flush of a large cache writes it back in the background
+    nCoinCacheUsage = 1;
+    BOOST_CHECK(FlushStateToDisk(chainparams, state, FLUSH_STATE_PERIODIC));
+    BOOST_CHECK(pcoinsTip->HaveWriteBack());
+    BOOST_CHECK(pcoinsTip->WriteBackMemoryUsage() > 0);
+
+    // The coins being written do not count against the limit
+    nCoinCacheUsage = pcoinsTip->EntriesMemoryUsage();
+    BOOST_CHECK(FlushStateToDisk(chainparams, state, FLUSH_STATE_IF_NEEDED));
+    BOOST_CHECK(pcoinsTip->HaveWriteBack());
+
+    // Over the limit the write back is finished and the rest written now
+    nCoinCacheUsage = 1;
+    BOOST_CHECK(FlushStateToDisk(chainparams, state, FLUSH_STATE_IF_NEEDED));
+    BOOST_CHECK(!pcoinsTip->HaveWriteBack());
+    BOOST_CHECK(pcoinsdbview->GetBestBlock() == chainActive.Tip()->GetBlockHash());
+
+    nCoinCacheUsage = nCoinCacheUsageOld;
+    fCoinsWriteBack = DEFAULT_COINS_WRITEBACK;
+    gArgs.ForceSetArg("-maxmempool", std::to_string(DEFAULT_MAX_MEMPOOL_SIZE));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
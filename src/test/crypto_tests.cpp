@@ -10,6 +10,7 @@
 #include <crypto/sha512.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
+#include <hash.h>
 #include <random.h>
 #include <utilstrencodings.h>
 #include <test/test_bitcoin.h>
@@ -540,6 +541,43 @@ BOOST_AUTO_TEST_CASE(chacha20_testvector)
                  "fab78c9");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[64 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 64 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+        }
+        SHA256D64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+        // In place, as used for merkle trees.
+        SHA256D64(in, in, i);
+        BOOST_CHECK(memcmp(out1, in, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sha256_multi)
+{
+    for (size_t size : {32, 55, 56, 64, 96, 120, 200}) {
+        for (size_t count = 0; count <= 20; ++count) {
+            std::vector<unsigned char> in(size * count);
+            std::vector<unsigned char> out1(32 * count), out2(32 * count);
+            for (size_t j = 0; j < in.size(); ++j) {
+                in[j] = InsecureRandBits(8);
+            }
+            for (size_t j = 0; j < count; ++j) {
+                CSHA256().Write(in.data() + size * j, size).Finalize(out1.data() + 32 * j);
+            }
+            SHA256Multi(out2.data(), in.data(), size, count);
+            BOOST_CHECK(out1 == out2);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(countbits_tests)
 {
     FastRandomContext ctx;
@@ -58,6 +58,39 @@ BOOST_AUTO_TEST_CASE(test_cuckoocache_no_fakes)
     }
 };
 
+/* Test that insert reports evictions only once the cache is overfull, never
+ * for an element that is already present, and exactly for the elements which
+ * were lost without a lookup having erased them.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_reports_evictions)
+{
+    local_rand_ctx = FastRandomContext(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    uint32_t n = cc.setup(1 << 10);
+    std::vector<uint256> inserted(5 * n / 2);
+    std::vector<bool> erased(inserted.size(), false);
+    size_t evictions = 0;
+    for (uint32_t x = 0; x < n / 2; ++x) {
+        insecure_GetRandHash(inserted[x]);
+        evictions += cc.insert(inserted[x]);
+    }
+    BOOST_CHECK_EQUAL(evictions, 0U);
+    BOOST_CHECK_EQUAL(cc.insert(inserted[n / 2 - 1]), 0U);
+    for (uint32_t x = n / 2; x < inserted.size(); ++x) {
+        insecure_GetRandHash(inserted[x]);
+        evictions += cc.insert(inserted[x]);
+        // Use up some of the elements, as block validation does
+        if (x % 7 == 0)
+            erased[x - 20] = cc.contains(inserted[x - 20], true);
+    }
+    size_t lost = 0;
+    for (uint32_t x = 0; x < inserted.size(); ++x)
+        lost += !erased[x] && !cc.contains(inserted[x], false);
+    BOOST_CHECK_EQUAL(evictions, lost);
+    // At most n of the 5n/2 inserted elements can still be held
+    BOOST_CHECK(lost + std::count(erased.begin(), erased.end(), true) >= 3 * n / 2);
+}
+
 /** This helper returns the hit rate when megabytes*load worth of entries are
  * inserted into a megabytes sized cache
  */
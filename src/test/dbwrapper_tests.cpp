@@ -4,10 +4,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <dbwrapper.h>
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <pow.h>
+#include <txdb.h>
 #include <uint256.h>
+#include <validation.h>
 #include <random.h>
 #include <test/test_bitcoin.h>
 
+#include <map>
 #include <memory>
 
 #include <boost/test/unit_test.hpp>
@@ -21,6 +30,34 @@ bool is_null_key(const std::vector<unsigned char>& key) {
 
     return isnull;
 }
+
+// A regtest block index entry following hashPrev, with a valid proof of work
+static CDiskBlockIndex MakeBlockIndexEntry(const Consensus::Params& params, const uint256& hashPrev, int nHeight, uint256& hash)
+{
+    CDiskBlockIndex entry;
+    entry.nHeight = nHeight;
+    entry.nMajorVersion = CBlockHeader::BPQ_MAJOR_VERSION;
+    entry.hashPrev = hashPrev;
+    entry.hashMerkleRoot = InsecureRand256();
+    entry.nBits = 0x207fffff;
+    entry.nSolution.assign(params.nSolutionSize, 0x5a);
+    do {
+        entry.nNonce = ArithToUint256(UintToArith256(entry.nNonce) + 1);
+        hash = entry.GetBlockHash();
+    } while (!CheckProofOfWork(hash, entry.nBits, nHeight >= params.BPQHeight, params));
+    entry.phashBlock = &hash;
+    return entry;
+}
+
+static CBlockIndex* InsertBlockIndex(std::map<uint256, std::unique_ptr<CBlockIndex> >& mapIndex, const uint256& hash)
+{
+    if (hash.IsNull())
+        return nullptr;
+    std::unique_ptr<CBlockIndex>& pindex = mapIndex[hash];
+    if (!pindex)
+        pindex.reset(new CBlockIndex());
+    return pindex.get();
+}
  
 BOOST_FIXTURE_TEST_SUITE(dbwrapper_tests, BasicTestingSetup)
                        
@@ -320,4 +357,102 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 
 
 
+// Block index entries with a header check are loaded under their key
+// without hashing, and checked later by CheckBlockIndexHashes
+BOOST_FIXTURE_TEST_CASE(block_index_header_check, TestingSetup)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::REGTEST);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    uint256 hashes[3];
+    std::vector<CDiskBlockIndex> entries;
+    entries.push_back(MakeBlockIndexEntry(params, uint256(), 0, hashes[0]));
+    entries.push_back(MakeBlockIndexEntry(params, hashes[0], 1, hashes[1]));
+    entries.push_back(MakeBlockIndexEntry(params, hashes[1], 2, hashes[2]));
+    // The first entry is written as before header checks
+    for (size_t i = 1; i < entries.size(); i++)
+        entries[i].nHeaderCheck = entries[i].ComputeHeaderCheck(hashes[i]);
+    BOOST_CHECK(blocktree.WriteBlockIndex(entries));
+
+    CDiskBlockIndex diskindex;
+    BOOST_CHECK(blocktree.ReadBlockIndex(hashes[0], diskindex));
+    BOOST_CHECK_EQUAL(diskindex.nHeaderCheck, 0U);
+    BOOST_CHECK(blocktree.ReadBlockIndex(hashes[2], diskindex));
+    BOOST_CHECK_EQUAL(diskindex.nHeaderCheck, entries[2].ComputeHeaderCheck(hashes[2]));
+
+    for (int nThreads : {1, 4}) {
+        std::map<uint256, std::unique_ptr<CBlockIndex> > mapIndex;
+        BOOST_CHECK(blocktree.LoadBlockIndexGuts(params, [&mapIndex](const uint256& hash) { return InsertBlockIndex(mapIndex, hash); }, nThreads));
+        BOOST_CHECK_EQUAL(mapIndex.size(), 3U);
+        BOOST_CHECK(mapIndex[hashes[0]]->pprev == nullptr);
+        BOOST_CHECK(mapIndex[hashes[2]]->pprev == mapIndex[hashes[1]].get());
+        BOOST_CHECK_EQUAL(mapIndex[hashes[2]]->nHeight, 2);
+        BOOST_CHECK(mapIndex[hashes[2]]->hashMerkleRoot == entries[2].hashMerkleRoot);
+    }
+
+    std::vector<uint256> vUnchecked;
+    BOOST_CHECK(blocktree.CheckBlockIndexHashes(params, vUnchecked));
+    BOOST_CHECK(vUnchecked == std::vector<uint256>{hashes[0]});
+
+    // An entry whose check does not match its key fails the load
+    uint256 hashWrong = InsecureRand256();
+    CDiskBlockIndex wrong = entries[2];
+    wrong.phashBlock = &hashWrong;
+    BOOST_CHECK(blocktree.WriteBlockIndex({wrong}));
+    BOOST_CHECK(!blocktree.LoadBlockIndexGuts(params, [](const uint256&) { return nullptr; }, 2));
+
+    // One whose check matches a wrong key is only caught by the hash check
+    wrong.nHeaderCheck = wrong.ComputeHeaderCheck(hashWrong);
+    BOOST_CHECK(blocktree.WriteBlockIndex({wrong}));
+    std::map<uint256, std::unique_ptr<CBlockIndex> > mapIndex;
+    BOOST_CHECK(blocktree.LoadBlockIndexGuts(params, [&mapIndex](const uint256& hash) { return InsertBlockIndex(mapIndex, hash); }, 2));
+    BOOST_CHECK(!blocktree.CheckBlockIndexHashes(params, vUnchecked));
+}
+
+// Coins flushed by several threads in small batches all end up in the
+// database, and the database is marked consistent with the new tip
+BOOST_FIXTURE_TEST_CASE(coins_db_parallel_flush, TestingSetup)
+{
+    gArgs.ForceSetArg("-dbbatchsize", "4096");
+    for (int nThreads : {1, 3}) {
+        gArgs.ForceSetArg("-dbflushthreads", std::to_string(nThreads));
+        CCoinsViewDB coinsdb(1 << 20, true);
+
+        std::vector<COutPoint> outpoints;
+        CCoinsMap mapCoins;
+        for (uint32_t i = 0; i < 2000; i++) {
+            COutPoint outpoint(InsecureRand256(), i);
+            CCoinsCacheEntry& entry = mapCoins[outpoint];
+            entry.coin = Coin(CTxOut(i + 1, CScript() << OP_TRUE), i, false);
+            entry.flags = CCoinsCacheEntry::DIRTY;
+            outpoints.push_back(outpoint);
+        }
+        uint256 hashBlock = InsecureRand256();
+        BOOST_CHECK(coinsdb.BatchWrite(mapCoins, hashBlock));
+        BOOST_CHECK(mapCoins.empty());
+        BOOST_CHECK(coinsdb.GetBestBlock() == hashBlock);
+        BOOST_CHECK(coinsdb.GetHeadBlocks().empty());
+        for (uint32_t i = 0; i < outpoints.size(); i++) {
+            Coin coin;
+            BOOST_CHECK(coinsdb.GetCoin(outpoints[i], coin));
+            BOOST_CHECK_EQUAL(coin.out.nValue, i + 1);
+        }
+
+        // Spend every other coin; entries which are not dirty are left alone
+        for (uint32_t i = 0; i < outpoints.size(); i++) {
+            CCoinsCacheEntry& entry = mapCoins[outpoints[i]];
+            if (i % 2 == 0)
+                entry.flags = CCoinsCacheEntry::DIRTY;
+        }
+        hashBlock = InsecureRand256();
+        BOOST_CHECK(coinsdb.BatchWrite(mapCoins, hashBlock));
+        BOOST_CHECK(coinsdb.GetBestBlock() == hashBlock);
+        for (uint32_t i = 0; i < outpoints.size(); i++)
+            BOOST_CHECK_EQUAL(coinsdb.HaveCoin(outpoints[i]), i % 2 == 1);
+    }
+    gArgs.ForceSetArg("-dbflushthreads", std::to_string(DEFAULT_DB_FLUSH_THREADS));
+    gArgs.ForceSetArg("-dbbatchsize", std::to_string(nDefaultDbBatchSize));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,12 +6,14 @@
 #include <key.h>
 
 #include <base58.h>
+#include <keystore.h>
 #include <script/script.h>
 #include <uint256.h>
 #include <util.h>
 #include <utilstrencodings.h>
 #include <test/test_bitcoin.h>
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -134,6 +136,38 @@ BOOST_AUTO_TEST_CASE(xmss_newkey2)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(xmss_newkeys)
+{
+	std::vector<CKey> keys(3);
+	CKey::MakeNewKeys(keys, CKeyType::XMSS_256_H10, 2);
+
+	std::set<CKeyID> ids;
+	for (CKey const & key : keys)
+	{
+		BOOST_CHECK(key.IsValid());
+
+		CPubKey pubkey = key.GetPubKey();
+		BOOST_CHECK(pubkey.GetKeyType() == CKeyType::XMSS_256_H10);
+		BOOST_CHECK(key.VerifyPubKey(pubkey));
+		ids.insert(pubkey.GetID());
+	}
+	BOOST_CHECK_EQUAL(ids.size(), keys.size());
+}
+
+BOOST_AUTO_TEST_CASE(xmss_newkeys_interrupt)
+{
+	std::vector<CKey> keys(3);
+	std::atomic<bool> interrupt(true);
+	BOOST_CHECK(!CKey::MakeNewKeys(keys, CKeyType::XMSS_256_H10, 2, &interrupt));
+	for (CKey const & key : keys)
+		BOOST_CHECK(!key.IsValid());
+
+	interrupt = false;
+	BOOST_CHECK(CKey::MakeNewKeys(keys, CKeyType::XMSS_256_H10, 2, &interrupt));
+	for (CKey const & key : keys)
+		BOOST_CHECK(key.IsValid());
+}
+
 BOOST_AUTO_TEST_CASE(xmss_base)
 {
     CBitcoinSecret bsecret1, bsecret2, bsecret3, bsecret4;
@@ -434,6 +468,131 @@ BOOST_AUTO_TEST_CASE(key_test1)
     BOOST_CHECK(detsigc == ParseHex("2052d8a32079c11e79db95af63bb9600c5b04f21a9ca33dc129c2bfa8ac9dc1cd561d8ae5e0f6c1a16bde3719c64c2fd70e404b6428ab9a69566962e8771b5944d"));
 }
 
+BOOST_AUTO_TEST_CASE(xmss_compact_keystore)
+{
+    CKey key;
+    key.MakeNewKey(CKeyType::XMSS_256_H10);
+    CPubKey pubkey = key.GetPubKey();
+
+    CKey other;
+    other.MakeNewKey(CKeyType::XMSS_256_H10);
+
+    // both key forms check against the public key without expanding
+    CKeyingMaterial vchLong = key.raw_private_key();
+    CKeyingMaterial vchShort = GetCompactXMSSSecret(vchLong);
+    BOOST_CHECK(vchShort == key.raw_short_key());
+    BOOST_CHECK(vchShort.size() < vchLong.size());
+    BOOST_CHECK(VerifyXMSSSecret(vchLong, pubkey));
+    BOOST_CHECK(VerifyXMSSSecret(vchShort, pubkey));
+    BOOST_CHECK(!VerifyXMSSSecret(vchShort, other.GetPubKey()));
+
+    // without a cache every GetKey rebuilds the hash tree
+    CBasicKeyStore keystore;
+    keystore.SetXMSSKeyCacheSize(0);
+    BOOST_CHECK(keystore.AddKeyPubKey(key, pubkey));
+    BOOST_CHECK(keystore.HaveKey(pubkey.GetID()));
+    BOOST_CHECK(keystore.GetKeys().count(pubkey.GetID()));
+    CPubKey pubkeyOut;
+    BOOST_CHECK(keystore.GetPubKey(pubkey.GetID(), pubkeyOut));
+    BOOST_CHECK(pubkeyOut == pubkey);
+    CKey keyOut;
+    BOOST_CHECK(keystore.GetKey(pubkey.GetID(), keyOut));
+    BOOST_CHECK(keyOut == key);
+
+    // long keys are stored compact, and mismatching secrets are refused
+    CBasicKeyStore loaded;
+    BOOST_CHECK(!loaded.LoadCompactKey(pubkey, other.raw_private_key(), false));
+    BOOST_CHECK(loaded.LoadCompactKey(pubkey, vchLong, false));
+    BOOST_CHECK(loaded.GetKey(pubkey.GetID(), keyOut));
+    BOOST_CHECK(keyOut == key);
+}
+
+class LazyKeyStore : public CBasicKeyStore
+{
+public:
+    std::map<CKeyID, CKeyingMaterial> mapSecrets;
+    mutable int nReads = 0;
+
+    bool ReadLazyKey(const CPubKey &pubkey, CKeyingMaterial& vchSecret) const override
+    {
+        auto it = mapSecrets.find(pubkey.GetID());
+        if (it == mapSecrets.end())
+            return false;
+        nReads++;
+        vchSecret = it->second;
+        return true;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(xmss_lazy_keystore)
+{
+    CKey key;
+    key.MakeNewKey(CKeyType::XMSS_256_H10);
+    CPubKey pubkey = key.GetPubKey();
+
+    LazyKeyStore keystore;
+    keystore.mapSecrets[pubkey.GetID()] = key.raw_short_key();
+    BOOST_CHECK(keystore.LoadLazyKey(pubkey));
+    BOOST_CHECK(keystore.HaveKey(pubkey.GetID()));
+    CPubKey pubkeyOut;
+    BOOST_CHECK(keystore.GetPubKey(pubkey.GetID(), pubkeyOut));
+    BOOST_CHECK(pubkeyOut == pubkey);
+    BOOST_CHECK_EQUAL(keystore.nReads, 0);
+
+    // the secret is read once, then the key is served from the cache
+    for (int i = 0; i < 2; i++) {
+        CKey keyOut;
+        BOOST_CHECK(keystore.GetKey(pubkey.GetID(), keyOut));
+        BOOST_CHECK(keyOut == key);
+    }
+    BOOST_CHECK_EQUAL(keystore.nReads, 1);
+
+    // a secret of another key is refused
+    CKey other;
+    other.MakeNewKey(CKeyType::XMSS_256_H10);
+    keystore.SetXMSSKeyCacheSize(0);
+    keystore.mapSecrets[pubkey.GetID()] = other.raw_short_key();
+    CKey keyOut;
+    BOOST_CHECK(!keystore.GetKey(pubkey.GetID(), keyOut));
+    BOOST_CHECK(!keystore.FetchLazyKeys());
+
+    keystore.mapSecrets[pubkey.GetID()] = key.raw_short_key();
+    BOOST_CHECK(keystore.FetchLazyKeys());
+    BOOST_CHECK(keystore.GetKey(pubkey.GetID(), keyOut));
+    BOOST_CHECK(keyOut == key);
+}
+
+BOOST_AUTO_TEST_CASE(xmss_key_cache_eviction)
+{
+    CKey key;
+    key.MakeNewKey(CKeyType::XMSS_256_H10);
+    CPubKey pubkey = key.GetPubKey();
+    CKey other;
+    other.MakeNewKey(CKeyType::XMSS_256_H10);
+
+    // the cache only has room for one of the keys
+    LazyKeyStore keystore;
+    keystore.SetXMSSKeyCacheSize(key.size());
+    keystore.mapSecrets[pubkey.GetID()] = key.raw_short_key();
+    keystore.mapSecrets[other.GetPubKey().GetID()] = other.raw_short_key();
+    BOOST_CHECK(keystore.LoadLazyKey(pubkey));
+    BOOST_CHECK(keystore.LoadLazyKey(other.GetPubKey()));
+    BOOST_CHECK(keystore.GetKeyHandle(pubkey.GetID()));
+    BOOST_CHECK(keystore.GetKeyHandle(other.GetPubKey().GetID()));
+    BOOST_CHECK_EQUAL(keystore.nReads, 2);
+
+    // the evicted key is expanded again once, then signs from the cache
+    uint256 hash = GetRandHash();
+    for (int i = 0; i < 2; i++) {
+        std::shared_ptr<const CKey> pkey = keystore.GetKeyHandle(pubkey.GetID());
+        BOOST_CHECK(pkey);
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK(pkey->SignHash(hash, vchSig));
+        BOOST_CHECK(pubkey.VerifyHash(hash, vchSig));
+    }
+    BOOST_CHECK_EQUAL(keystore.nReads, 3);
+}
+
 #if 0
 BOOST_AUTO_TEST_CASE(witness_v1_meta)
 {
@@ -0,0 +1,92 @@
+// Copyright (c) 2018 The Bitcoin Post-Quantum developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/test_bitcoin.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pool_resource_reuse)
+{
+    PoolResource<64, 8> resource;
+
+    // Blocks are rounded up to the alignment and handed out from one chunk
+    void* a = resource.Allocate(20, 8);
+    void* b = resource.Allocate(24, 8);
+    BOOST_CHECK_EQUAL(resource.UsedBytes(), 48U);
+    BOOST_CHECK_EQUAL(static_cast<char*>(b) - static_cast<char*>(a), 24);
+    size_t nChunkBytes = resource.ChunkBytes();
+    BOOST_CHECK(nChunkBytes > 0);
+
+    // A freed block is reused for the next one of its size
+    resource.Deallocate(a, 20, 8);
+    BOOST_CHECK_EQUAL(resource.UsedBytes(), 24U);
+    BOOST_CHECK_EQUAL(resource.FreeBytes(), 24U);
+    BOOST_CHECK(resource.Allocate(17, 8) == a);
+    BOOST_CHECK_EQUAL(resource.FreeBytes(), 0U);
+    resource.Deallocate(b, 24, 8);
+
+    // Large or overaligned blocks do not come from the pool
+    void* c = resource.Allocate(65, 8);
+    void* d = resource.Allocate(16, 16);
+    BOOST_CHECK_EQUAL(resource.UsedBytes(), 24U);
+    resource.Deallocate(c, 65, 8);
+    resource.Deallocate(d, 16, 16);
+
+    // New chunks are only allocated once one is used up
+    std::vector<void*> blocks;
+    while (resource.ChunkBytes() == nChunkBytes)
+        blocks.push_back(resource.Allocate(64, 8));
+    BOOST_CHECK_EQUAL(resource.ChunkBytes(), 2 * nChunkBytes);
+    for (void* p : blocks)
+        resource.Deallocate(p, 64, 8);
+    BOOST_CHECK_EQUAL(resource.UsedBytes(), 24U);
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_coins_map)
+{
+    CCoinsMap map;
+    std::vector<COutPoint> outpoints;
+    for (uint32_t i = 0; i < 1000; i++) {
+        outpoints.emplace_back(InsecureRand256(), i);
+        map[outpoints.back()].coin = Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false);
+    }
+    // The pool's chunks count, not only the blocks in use
+    size_t nUsage = memusage::DynamicUsage(map);
+    BOOST_CHECK(map.get_allocator().resource().UsedBytes() > 1000 * sizeof(CCoinsMapValue));
+    BOOST_CHECK_EQUAL(nUsage, map.get_allocator().resource().ChunkBytes() + memusage::MallocUsage(sizeof(void*) * map.bucket_count()));
+
+    // A copy has a pool of its own and stays valid after the original is gone
+    std::unique_ptr<CCoinsMap> copy(new CCoinsMap(map));
+    BOOST_CHECK(copy->get_allocator() != map.get_allocator());
+    BOOST_CHECK_EQUAL(copy->get_allocator().resource().UsedBytes(), map.get_allocator().resource().UsedBytes());
+
+    // Erased entries leave their blocks in the pool, which still counts
+    for (uint32_t i = 0; i < 500; i++)
+        BOOST_CHECK_EQUAL(map.erase(outpoints[i]), 1U);
+    map.clear();
+    BOOST_CHECK_EQUAL(map.get_allocator().resource().UsedBytes(), 0U);
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), map.get_allocator().resource().ChunkBytes() + memusage::MallocUsage(sizeof(void*) * map.bucket_count()));
+    BOOST_CHECK(memusage::DynamicUsage(map) > memusage::MallocUsage(sizeof(void*) * map.bucket_count()));
+
+    for (uint32_t i = 0; i < outpoints.size(); i++) {
+        auto it = copy->find(outpoints[i]);
+        BOOST_CHECK(it != copy->end() && it->second.coin.out.nValue == i + 1);
+    }
+
+    // Moving takes the pool along with the entries
+    CCoinsMap moved(std::move(*copy));
+    copy.reset();
+    BOOST_CHECK_EQUAL(moved.size(), 1000U);
+    BOOST_CHECK(moved.find(outpoints[999]) != moved.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,13 +3,21 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <arith_uint256.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <clientversion.h>
+#include <consensus/validation.h>
+#include <crypto/equihash.h>
 #include <pow.h>
 #include <random.h>
+#include <streams.h>
 #include <util.h>
+#include <validation.h>
 #include <test/test_bitcoin.h>
 
+#include <set>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(pow_tests, BasicTestingSetup)
@@ -84,4 +92,182 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/* Build a chain of pre-fork headers on the regtest genesis block, where the
+ * headers at the positions in vInvalid fail their proof of work */
+static std::vector<CBlockHeader> CreateHeaders(size_t nCount, const std::set<size_t>& vInvalid)
+{
+    const CChainParams& params = Params();
+    std::vector<CBlockHeader> headers;
+    uint256 hashPrev = params.GenesisBlock().GetHash();
+    for (size_t i = 0; i < nCount; i++) {
+        CBlockHeader header;
+        header.SetMajorVersion(CBlockHeader::BITCOIN_MAJOR_VERSION);
+        header.SetMinorVersion(4);
+        header.SetHashPrevBlock(hashPrev);
+        header.SetHashMerkleRoot(InsecureRand256());
+        header.SetTime(params.GenesisBlock().GetBlockTime() + 600 * (i + 1));
+        header.SetBits(params.GenesisBlock().GetBits());
+        header.SetSolution(std::vector<unsigned char>(params.GetConsensus().nSolutionSize));
+        bool fInvalid = vInvalid.count(i) > 0;
+        uint64_t nNonce = 0;
+        do {
+            header.SetNonce(ArithToUint256(arith_uint256(++nNonce)));
+        } while (CheckProofOfWork(header.GetHash(), header.GetBits(), false, params.GetConsensus()) == fInvalid);
+        hashPrev = header.GetHash();
+        headers.push_back(header);
+    }
+    return headers;
+}
+
+/* The parallel proof of work pass reports the first invalid header of a batch */
+BOOST_FIXTURE_TEST_CASE(process_headers_first_invalid, RegtestingSetup)
+{
+    const CChainParams& params = Params();
+
+    std::vector<CBlockHeader> headers = CreateHeaders(20, {12, 5});
+    CValidationState state;
+    CBlockHeader first_invalid;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, params, nullptr, &first_invalid));
+    BOOST_CHECK(first_invalid.GetHash() == headers[5].GetHash());
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < 5; i++)
+            BOOST_CHECK(mapBlockIndex.count(headers[i].GetHash()));
+        for (size_t i = 5; i < headers.size(); i++)
+            BOOST_CHECK(!mapBlockIndex.count(headers[i].GetHash()));
+    }
+
+    // The valid headers before it were accepted and are not checked again
+    headers.resize(5);
+    const CBlockIndex* pindex = nullptr;
+    CValidationState state2;
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state2, params, &pindex));
+    BOOST_CHECK(pindex != nullptr && pindex->GetBlockHash() == headers.back().GetHash());
+
+    // A batch without invalid headers is accepted as a whole
+    std::vector<CBlockHeader> valid = CreateHeaders(20, {});
+    BOOST_CHECK(ProcessNewBlockHeaders(valid, state2, params, &pindex));
+    BOOST_CHECK(pindex != nullptr && pindex->GetBlockHash() == valid.back().GetHash());
+}
+
+/* Solve a post-fork block on the regtest genesis block */
+static CBlock CreateSolvedBlock()
+{
+    const CChainParams& params = Params();
+    CBlock block;
+    block.SetMajorVersion(CBlockHeader::BPQ_MAJOR_VERSION);
+    block.SetMinorVersion(4);
+    block.SetHashPrevBlock(params.GenesisBlock().GetHash());
+    block.SetHashMerkleRoot(InsecureRand256());
+    block.SetTime(params.GenesisBlock().GetBlockTime() + 600);
+    block.SetBits(params.GenesisBlock().GetBits());
+
+    unsigned int n = params.EquihashN();
+    unsigned int k = params.EquihashK();
+    crypto_generichash_blake2b_state eh_state;
+    EhInitialiseState(n, k, eh_state);
+    CEquihashInput I{block};
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << I;
+    crypto_generichash_blake2b_update(&eh_state, (unsigned char*)&ss[0], ss.size());
+
+    std::function<bool(std::vector<unsigned char>)> validBlock =
+            [&block, &params](std::vector<unsigned char> soln) {
+        block.SetSolution(soln);
+        return CheckProofOfWork(block.GetHash(), block.GetBits(), true, params.GetConsensus());
+    };
+    bool found = false;
+    while (!found) {
+        block.SetNonce(ArithToUint256(UintToArith256(block.GetNonce()) + 1));
+        crypto_generichash_blake2b_state curr_state = eh_state;
+        crypto_generichash_blake2b_update(&curr_state, block.GetNonce().begin(), block.GetNonce().size());
+        found = EhBasicSolveUncancellable(n, k, curr_state, validBlock);
+    }
+    return block;
+}
+
+/* Write a block to its own block file the way AcceptBlock does */
+static CDiskBlockPos WriteTestBlock(const CBlock& block, int nFile)
+{
+    CDiskBlockPos pos(nFile, 0);
+    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!fileout.IsNull());
+    unsigned int nSize = GetSerializeSize(fileout, block);
+    fileout << FLATDATA(Params().MessageStart()) << nSize;
+    pos.nPos = (unsigned int)ftell(fileout.Get());
+    fileout << block;
+    return pos;
+}
+
+/* Reads through a block index that made it into the tree skip the Equihash
+ * check unless -checkblocksolutions is set, and still reject blocks whose
+ * data on disk does not match the index */
+BOOST_FIXTURE_TEST_CASE(read_block_solution_check, RegtestingSetup)
+{
+    const CChainParams& params = Params();
+    const Consensus::Params& consensus = params.GetConsensus();
+    CBlock good = CreateSolvedBlock();
+    BOOST_REQUIRE(CheckEquihashSolution(&good, params));
+
+    // Corrupt the solution, keeping a hash that still meets the target so
+    // that only the Equihash check can tell
+    CBlock bad = good;
+    std::vector<unsigned char> solution = good.GetSolution();
+    for (size_t i = 0; ; i++) {
+        BOOST_REQUIRE(i < solution.size());
+        std::vector<unsigned char> corrupted = solution;
+        corrupted[i] ^= 0x01;
+        bad.SetSolution(corrupted);
+        if (CheckProofOfWork(bad.GetHash(), bad.GetBits(), true, consensus) && !CheckEquihashSolution(&bad, params))
+            break;
+    }
+
+    CDiskBlockPos posGood = WriteTestBlock(good, 90);
+    CDiskBlockPos posBad = WriteTestBlock(bad, 91);
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, posGood, consensus));
+    BOOST_CHECK(block.GetHash() == good.GetHash());
+    BOOST_CHECK(!ReadBlockFromDisk(block, posBad, consensus));
+    BOOST_CHECK(ReadBlockFromDisk(block, posBad, consensus, false));
+
+    uint256 hashBad = bad.GetHash();
+    CBlockIndex index(bad);
+    index.phashBlock = &hashBad;
+    index.nFile = posBad.nFile;
+    index.nDataPos = posBad.nPos;
+    index.nStatus = BLOCK_VALID_TREE | BLOCK_HAVE_DATA;
+
+    // An index below BLOCK_VALID_TREE is always checked
+    uint256 hashGood = good.GetHash();
+    CBlockIndex indexHeader(good);
+    indexHeader.phashBlock = &hashGood;
+    indexHeader.nFile = posGood.nFile;
+    indexHeader.nDataPos = posGood.nPos;
+    indexHeader.nStatus = BLOCK_VALID_HEADER | BLOCK_HAVE_DATA;
+    BOOST_CHECK(ReadBlockFromDisk(block, &indexHeader, consensus));
+    CBlockIndex indexHeaderBad(index);
+    indexHeaderBad.nStatus = BLOCK_VALID_HEADER | BLOCK_HAVE_DATA;
+
+    // Data on disk that does not match the index is rejected either way
+    CBlockIndex indexMismatch(indexHeader);
+    indexMismatch.nFile = posBad.nFile;
+    indexMismatch.nDataPos = posBad.nPos;
+    indexMismatch.nStatus = BLOCK_VALID_TREE | BLOCK_HAVE_DATA;
+
+    bool fCheckBlockSolutionsOld = fCheckBlockSolutions;
+    fCheckBlockSolutions = false;
+    BOOST_CHECK(ReadBlockFromDisk(block, &index, consensus));
+    BOOST_CHECK(block.GetHash() == hashBad);
+    BOOST_CHECK(!ReadBlockFromDisk(block, &indexHeaderBad, consensus));
+    BOOST_CHECK(!ReadBlockFromDisk(block, &indexMismatch, consensus));
+
+    // -checkblocksolutions turns the check back on
+    fCheckBlockSolutions = true;
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, consensus));
+    BOOST_CHECK(!ReadBlockFromDisk(block, &indexMismatch, consensus));
+    BOOST_CHECK(ReadBlockFromDisk(block, &indexHeader, consensus));
+    fCheckBlockSolutions = fCheckBlockSolutionsOld;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -796,4 +796,45 @@ BOOST_AUTO_TEST_CASE(script_standard_IsMine)
     }
 }
 
+BOOST_AUTO_TEST_CASE(script_standard_MayOwnScript)
+{
+    CKey key, xmssKey, otherKey;
+    key.MakeNewKey(CKeyType::ECDSA_COMPRESSED);
+    xmssKey.MakeNewKey(CKeyType::XMSS_256_H10);
+    otherKey.MakeNewKey(CKeyType::ECDSA_COMPRESSED);
+
+    CBasicKeyStore keystore;
+    BOOST_CHECK(keystore.AddKey(key));
+    BOOST_CHECK(keystore.AddKey(xmssKey));
+
+    CScript xmssP2PK = GetScriptForRawPubKey(xmssKey.GetPubKey());
+    CScript multisig = GetScriptForMultisig(1, {otherKey.GetPubKey()});
+
+    // Scripts of own keys pass
+    BOOST_CHECK(keystore.MayOwnScript(GetScriptForRawPubKey(key.GetPubKey())));
+    BOOST_CHECK(keystore.MayOwnScript(GetScriptForDestination(key.GetPubKey().GetID())));
+    BOOST_CHECK(keystore.MayOwnScript(GetScriptForDestination(WitnessV0KeyHash(key.GetPubKey().GetID()))));
+    BOOST_CHECK(keystore.MayOwnScript(xmssP2PK));
+    BOOST_CHECK(keystore.MayOwnScript(GetScriptForDestination(WitnessV1ScriptHash(xmssP2PK))));
+
+    // Scripts of other keys are rejected
+    BOOST_CHECK(!keystore.MayOwnScript(GetScriptForRawPubKey(otherKey.GetPubKey())));
+    BOOST_CHECK(!keystore.MayOwnScript(GetScriptForDestination(otherKey.GetPubKey().GetID())));
+    BOOST_CHECK(!keystore.MayOwnScript(GetScriptForDestination(WitnessV0KeyHash(otherKey.GetPubKey().GetID()))));
+    BOOST_CHECK(!keystore.MayOwnScript(GetScriptForDestination(WitnessV1ScriptHash(multisig))));
+    BOOST_CHECK(!keystore.MayOwnScript(GetScriptForDestination(CScriptID(multisig, 0))));
+    BOOST_CHECK_EQUAL(IsMine(keystore, GetScriptForDestination(otherKey.GetPubKey().GetID())), ISMINE_NO);
+
+    // Scripts Solver has to look at always pass
+    BOOST_CHECK(keystore.MayOwnScript(multisig));
+
+    // Added scripts and watch-only scripts pass
+    keystore.AddCScript(multisig, 1);
+    BOOST_CHECK(keystore.MayOwnScript(GetScriptForDestination(WitnessV1ScriptHash(multisig))));
+    CScript watched = GetScriptForDestination(WitnessV0KeyHash(otherKey.GetPubKey().GetID()));
+    keystore.AddWatchOnly(watched, 0);
+    BOOST_CHECK(keystore.MayOwnScript(watched));
+    BOOST_CHECK_EQUAL(IsMine(keystore, watched), ISMINE_WATCH_UNSOLVABLE);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include <serialize.h>
 #include <streams.h>
 #include <hash.h>
+#include <primitives/block.h>
 #include <test/test_bitcoin.h>
 
 #include <stdint.h>
@@ -365,4 +366,42 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(block_header_cached_hash)
+{
+    CBlockHeader header;
+    header.SetMajorVersion(CBlockHeader::BPQ_MAJOR_VERSION);
+    header.SetHashPrevBlock(InsecureRand256());
+    header.SetBits(0x207fffff);
+    header.SetSolution(std::vector<unsigned char>(100, 0x5a));
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << header;
+    CBlockHeader header2;
+    ss >> header2;
+    BOOST_CHECK(header2.GetHash() == header.GetHash());
+
+    // Every setter drops the hash cached while deserializing
+    header2.SetNonce(InsecureRand256());
+    BOOST_CHECK(header2.GetHash() == header2.ComputeHash());
+    BOOST_CHECK(header2.GetHash() != header.GetHash());
+
+    ss << header;
+    ss >> header2;
+    header2.SetTime(1);
+    BOOST_CHECK(header2.GetHash() == header2.ComputeHash());
+
+    ss << header;
+    ss >> header2;
+    header2.SetSolution(std::vector<unsigned char>(100, 0xa5));
+    BOOST_CHECK(header2.GetHash() == header2.ComputeHash());
+
+    // A block keeps the cached hash of its header, and so does a header copied from it
+    CBlock block;
+    ss << CBlock(header);
+    ss >> block;
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == header.GetHash());
+    block.SetHashMerkleRoot(InsecureRand256());
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == block.ComputeHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -208,4 +208,30 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
+
+// Goal: check that SignatureMessage agrees with Signature and SignatureHash
+BOOST_AUTO_TEST_CASE(sighash_message)
+{
+    SeedInsecureRand(false);
+
+    std::vector<unsigned char> msg;
+    for (int i = 0; i < 1000; i++) {
+        int nHashType = InsecureRand32();
+        CMutableTransaction mtx;
+        RandomTransaction(mtx, (nHashType & 0x1f) == SIGHASH_SINGLE);
+        const CTransaction txTo(mtx);
+        PrecomputedTransactionData txdata(txTo);
+        CScript scriptCode;
+        RandomScript(scriptCode);
+        int nIn = InsecureRandRange(txTo.vin.size());
+        CAmount amount = InsecureRandRange(MAX_MONEY);
+
+        for (SigVersion sigversion : {SIGVERSION_BASE, SIGVERSION_WITNESS_V0, SIGVERSION_WITNESS_V1}) {
+            uint256 msghash = SignatureMessage(msg, scriptCode, txTo, nIn, nHashType, amount, sigversion, &txdata);
+            CDataStream ss = Signature(scriptCode, txTo, nIn, nHashType, amount, sigversion);
+            BOOST_CHECK(std::vector<unsigned char>(ss.begin(), ss.end()) == msg);
+            BOOST_CHECK(msghash == SignatureHash(scriptCode, txTo, nIn, nHashType, amount, sigversion));
+        }
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
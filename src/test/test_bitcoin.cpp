@@ -91,6 +91,8 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         nScriptCheckThreads = 3;
         for (int i=0; i < nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i < nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadHeaderCheck);
         g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
         connman = g_connman.get();
         peerLogic.reset(new PeerLogicValidation(connman, scheduler));
@@ -150,8 +152,8 @@ TestChain100Setup::CreateAndProcessBlock(const std::vector<CMutableTransaction>&
     }
 
     // TODO: Generate Equihash solution if applicable.
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, false, chainparams.GetConsensus())) {
-        block.nNonce = ArithToUint256(UintToArith256(block.nNonce) + 1);
+    while (!CheckProofOfWork(block.GetHash(), block.GetBits(), false, chainparams.GetConsensus())) {
+        block.SetNonce(ArithToUint256(UintToArith256(block.GetNonce()) + 1));
     }
 
     std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
@@ -71,6 +71,10 @@ struct TestingSetup: public BasicTestingSetup {
     ~TestingSetup();
 };
 
+struct RegtestingSetup : public TestingSetup {
+    RegtestingSetup() : TestingSetup(CBaseChainParams::REGTEST) {}
+};
+
 class CBlock;
 struct CMutableTransaction;
 class CScript;
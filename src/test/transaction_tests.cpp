@@ -24,6 +24,7 @@
 #include <utilstrencodings.h>
 
 #include <map>
+#include <set>
 #include <string>
 
 #include <boost/algorithm/string/classification.hpp>
@@ -505,6 +506,116 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction) {
     threadGroup.join_all();
 }
 
+BOOST_AUTO_TEST_CASE(test_parallel_xmss_signing)
+{
+    CBasicKeyStore keystore;
+    CKey keyXMSS, keyECDSA;
+    keyXMSS.MakeNewKey(CKeyType::XMSS_256_H10);
+    keyECDSA.MakeNewKey(CKeyType::ECDSA_COMPRESSED);
+    keystore.AddKey(keyXMSS);
+    keystore.AddKey(keyECDSA);
+
+    CScript scriptXMSS = GetScriptForDestination(WitnessV1ScriptHash(GetScriptForRawPubKey(keyXMSS.GetPubKey())));
+    CScript scriptECDSA = GetScriptForDestination(WitnessV0KeyHash(keyECDSA.GetPubKey().GetID()));
+
+    // XMSS inputs with an ECDSA input in between
+    CMutableTransaction mtx;
+    std::vector<CTxOut> vSpent;
+    for (uint32_t i = 0; i < 9; i++) {
+        uint256 prevId;
+        prevId.SetHex("0000000000000000000000000000000000000000000000000000000000000100");
+        mtx.vin.emplace_back(COutPoint(prevId, i));
+        vSpent.emplace_back(1000, i == 4 ? scriptECDSA : scriptXMSS);
+    }
+    mtx.vout.emplace_back(8000, CScript() << OP_1);
+
+    BOOST_CHECK(SignTransactionInputs(keystore, mtx, vSpent, SIGHASH_ALL, 4));
+
+    const CTransaction tx(mtx);
+    std::set<int64_t> setIndices;
+    for (uint32_t i = 0; i < tx.vin.size(); i++) {
+        ScriptError serror;
+        BOOST_CHECK(VerifyScript(tx.vin[i].scriptSig, vSpent[i].scriptPubKey, &tx.vin[i].scriptWitness, STANDARD_SCRIPT_VERIFY_FLAGS,
+            TransactionSignatureChecker(&tx, i, vSpent[i].nValue), &serror));
+        if (i != 4)
+            setIndices.insert(xmss_get_use_count_from_der_sig(tx.vin[i].scriptWitness.stack[0]));
+    }
+    // every XMSS signature used its own leaf
+    BOOST_CHECK_EQUAL(setIndices.size(), 8U);
+    BOOST_CHECK_EQUAL(keystore.GetKeyUseCount(keyXMSS.GetPubKey().GetID()), 8U);
+}
+
+BOOST_AUTO_TEST_CASE(test_xmss_dummy_signature_size)
+{
+    for (CKeyType keytype : {CKeyType::XMSS_256_H10, CKeyType::XMSS_256_H16}) {
+        CBasicKeyStore keystore;
+        CKey key;
+        key.MakeNewKey(keytype);
+        keystore.AddKey(key);
+        CScript scriptPubKey = GetScriptForDestination(WitnessV1ScriptHash(GetScriptForRawPubKey(key.GetPubKey())));
+
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(COutPoint(uint256S("0000000000000000000000000000000000000000000000000000000000000100"), 0));
+        mtx.vout.emplace_back(1000, CScript() << OP_1);
+
+        // fee estimation needs the exact size, without spending a leaf
+        SignatureData dummy, real;
+        BOOST_CHECK(ProduceSignature(DummySignatureCreator(&keystore), scriptPubKey, dummy));
+        BOOST_CHECK_EQUAL(keystore.GetKeyUseCount(key.GetPubKey().GetID()), 0U);
+        BOOST_CHECK(ProduceSignature(MutableTransactionSignatureCreator(&keystore, &mtx, 0, 1000, SIGHASH_ALL), scriptPubKey, real));
+        BOOST_CHECK_EQUAL(dummy.scriptWitness.stack[0].size(), real.scriptWitness.stack[0].size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_extract_xmss_signatures)
+{
+    CBasicKeyStore keystore;
+    CKey keyXMSS, keyECDSA;
+    keyXMSS.MakeNewKey(CKeyType::XMSS_256_H10);
+    keyECDSA.MakeNewKey(CKeyType::ECDSA_COMPRESSED);
+    keystore.AddKey(keyXMSS);
+    keystore.AddKey(keyECDSA);
+
+    CScript scriptMulti = GetScriptForMultisig(2, {keyXMSS.GetPubKey(), keyECDSA.GetPubKey()});
+    keystore.AddCScript(scriptMulti, 1);
+    std::vector<CScript> vScripts = {
+        GetScriptForDestination(WitnessV1ScriptHash(GetScriptForRawPubKey(keyXMSS.GetPubKey()))),
+        GetScriptForDestination(WitnessV1ScriptHash(scriptMulti))};
+
+    CMutableTransaction mtx;
+    for (uint32_t i = 0; i < vScripts.size(); i++)
+        mtx.vin.emplace_back(COutPoint(uint256S("0000000000000000000000000000000000000000000000000000000000000100"), i));
+    mtx.vout.emplace_back(1000, CScript() << OP_1);
+    for (uint32_t i = 0; i < vScripts.size(); i++)
+        BOOST_CHECK(SignSignature(keystore, vScripts[i], mtx, i, 1000, SIGHASH_ALL));
+
+    for (uint32_t i = 0; i < vScripts.size(); i++) {
+        std::vector<std::pair<CPubKey, int64_t> > vSigs;
+        BOOST_CHECK(ExtractXMSSSignatures(mtx.vin[i].scriptWitness, vSigs));
+        BOOST_REQUIRE_EQUAL(vSigs.size(), 1U);
+        BOOST_CHECK(vSigs[0].first == keyXMSS.GetPubKey());
+        BOOST_CHECK_EQUAL(vSigs[0].second, (int64_t)i);
+
+        // the script interpreter finds the same leaf
+        CollectorSignatureChecker checker;
+        BOOST_CHECK(VerifyScript(mtx.vin[i].scriptSig, vScripts[i], &mtx.vin[i].scriptWitness, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS, checker));
+        for (const auto& p : checker.m_signatures) {
+            if (xmss_is_der_pubkey(p.first))
+                BOOST_CHECK_EQUAL(xmss_get_use_count_from_der_sig(p.second), vSigs[0].second);
+        }
+    }
+
+    // with a signature missing it takes the script to tell which key made the other
+    CScriptWitness witness = mtx.vin[1].scriptWitness;
+    witness.stack.erase(witness.stack.begin() + 2);
+    std::vector<std::pair<CPubKey, int64_t> > vSigs;
+    BOOST_CHECK(!ExtractXMSSSignatures(witness, vSigs));
+
+    // inputs without XMSS signatures have nothing to report
+    BOOST_CHECK(ExtractXMSSSignatures(CScriptWitness(), vSigs));
+    BOOST_CHECK(vSigs.empty());
+}
+
 BOOST_AUTO_TEST_CASE(test_witness)
 {
     CBasicKeyStore keystore, keystore2;
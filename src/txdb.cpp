@@ -15,7 +15,12 @@
 #include <ui_interface.h>
 #include <init.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <stdint.h>
+#include <thread>
 
 #include <boost/thread.hpp>
 
@@ -83,11 +88,21 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    return WriteCoins(mapCoins, hashBlock, true);
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // Not modified as nothing is erased
+    return WriteCoins(const_cast<CCoinsMap&>(mapCoins), hashBlock, false);
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
     size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+    int nThreads = std::max((int)gArgs.GetArg("-dbflushthreads", DEFAULT_DB_FLUSH_THREADS), 1);
     assert(!hashBlock.IsNull());
 
     uint256 old_tip = GetBestBlock();
@@ -104,33 +119,128 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // transition from old_tip to hashBlock.
     // A vector is used for future extensibility, as we may want to support
     // interrupting after partial writes from multiple independent reorgs.
+    // It is written on its own, as the coin batches after it may be written
+    // in any order.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
+    db.WriteBatch(batch);
+    batch.Clear();
+
+    // Dirty coins are moved (or copied, when not erasing) out of the map in
+    // chunks of about batch_size bytes. Each chunk is serialized into a batch of its own and written by
+    // one of nThreads threads, while this thread goes on with the next chunk.
+    // Every outpoint is in one chunk only, so the order of the writes does
+    // not matter until the last batch below.
+    typedef std::vector<std::pair<COutPoint, Coin> > CoinChunk;
+
+    auto write_chunk = [&](const CoinChunk& chunk, FastRandomContext& rng) {
+        CDBBatch chunk_batch(db);
+        for (size_t i = 0; i < chunk.size(); i++) {
+            CoinEntry entry(&chunk[i].first);
+            if (chunk[i].second.IsSpent())
+                chunk_batch.Erase(entry);
+            else
+                chunk_batch.Write(entry, chunk[i].second);
+            if (chunk_batch.SizeEstimate() > batch_size || i + 1 == chunk.size()) {
+                LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", chunk_batch.SizeEstimate() * (1.0 / 1048576.0));
+                db.WriteBatch(chunk_batch);
+                chunk_batch.Clear();
+                if (crash_simulate) {
+                    if (rng.randrange(crash_simulate) == 0) {
+                        LogPrintf("Simulating a crash. Goodbye.\n");
+                        _Exit(0);
+                    }
+                }
+            }
+        }
+    };
+
+    std::mutex cs_chunks;
+    std::condition_variable cond_chunks;
+    std::deque<CoinChunk> queue_chunks;
+    bool fDone = false;
+    std::string strError;
+
+    auto worker = [&]() {
+        FastRandomContext rng;
+        while (true) {
+            CoinChunk chunk;
+            {
+                std::unique_lock<std::mutex> lock(cs_chunks);
+                cond_chunks.wait(lock, [&] { return !queue_chunks.empty() || fDone || !strError.empty(); });
+                if (queue_chunks.empty() || !strError.empty())
+                    return;
+                chunk = std::move(queue_chunks.front());
+                queue_chunks.pop_front();
+            }
+            cond_chunks.notify_all();
+            try {
+                write_chunk(chunk, rng);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(cs_chunks);
+                strError = e.what();
+                cond_chunks.notify_all();
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    if (nThreads > 1) {
+        threads.reserve(nThreads);
+        for (int i = 0; i < nThreads; i++)
+            threads.emplace_back(worker);
+    }
+    FastRandomContext rng;
 
+    // Hands a chunk to the workers, waiting while each has one queued already
+    auto submit_chunk = [&](CoinChunk& chunk) {
+        if (threads.empty()) {
+            write_chunk(chunk, rng);
+        } else {
+            std::unique_lock<std::mutex> lock(cs_chunks);
+            cond_chunks.wait(lock, [&] { return queue_chunks.size() < threads.size() || !strError.empty(); });
+            queue_chunks.push_back(std::move(chunk));
+            cond_chunks.notify_all();
+        }
+        chunk.clear();
+    };
+
+    CoinChunk chunk;
+    size_t chunk_size = 0;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent())
-                batch.Erase(entry);
+            // Roughly what the entry takes in a batch
+            chunk_size += COIN_BATCH_ENTRY_SIZE + it->second.coin.out.scriptPubKey.size();
+            if (fErase)
+                chunk.emplace_back(it->first, std::move(it->second.coin));
             else
-                batch.Write(entry, it->second.coin);
+                chunk.emplace_back(it->first, it->second.coin);
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
-        if (batch.SizeEstimate() > batch_size) {
-            LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-            db.WriteBatch(batch);
-            batch.Clear();
-            if (crash_simulate) {
-                static FastRandomContext rng;
-                if (rng.randrange(crash_simulate) == 0) {
-                    LogPrintf("Simulating a crash. Goodbye.\n");
-                    _Exit(0);
-                }
-            }
+        if (fErase)
+            it = mapCoins.erase(it);
+        else
+            ++it;
+        if (chunk_size > batch_size) {
+            submit_chunk(chunk);
+            chunk_size = 0;
+        }
+    }
+    if (!chunk.empty())
+        submit_chunk(chunk);
+
+    if (!threads.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(cs_chunks);
+            fDone = true;
         }
+        cond_chunks.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+        if (!strError.empty())
+            throw dbwrapper_error(strError);
     }
 
     // In the last batch, mark the database as consistent with hashBlock again.
@@ -225,18 +335,22 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
-bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
+bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<CDiskBlockIndex>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
-    for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
-        batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+    for (std::vector<CDiskBlockIndex>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, it->CBlockIndex::GetBlockHash()), *it);
     }
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadBlockIndex(const uint256 &hash, CDiskBlockIndex &diskindex) {
+    return Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex);
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
     return Read(std::make_pair(DB_TXINDEX, txid), pos);
 }
@@ -260,54 +374,155 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads)
+{
+    // Entries written with a header check are stored under their block hash
+    // and only the check is verified here. Older ones have their header hashed
+    // (with the solution) and their proof of work checked, which is what takes
+    // the time, so that runs on nThreads threads, each walking its own slices
+    // of the key space with its own cursor. Entries are split on the
+    // first byte of the block hash, which is spread evenly. Only the hashes
+    // and the header fields are kept, the index objects are then created and
+    // linked on this thread, as insertBlockIndex is not thread safe.
+    nThreads = std::max(1, std::min(nThreads, BLOCK_INDEX_LOAD_SLICES));
+
+    std::vector<std::vector<std::pair<uint256, CDiskBlockIndex> > > vSlices(BLOCK_INDEX_LOAD_SLICES);
+    std::atomic<int> nextSlice(0);
+    std::atomic<bool> fFailed(false);
+
+    auto worker = [&]() {
+        for (int nSlice = nextSlice++; nSlice < BLOCK_INDEX_LOAD_SLICES && !fFailed; nSlice = nextSlice++) {
+            const unsigned int nBegin = nSlice * 256 / BLOCK_INDEX_LOAD_SLICES;
+            const unsigned int nEnd = (nSlice + 1) * 256 / BLOCK_INDEX_LOAD_SLICES;
+            std::vector<std::pair<uint256, CDiskBlockIndex> >& vEntries = vSlices[nSlice];
+
+            std::unique_ptr<CDBIterator> pcursor(NewIterator());
+            uint256 hashBegin;
+            *hashBegin.begin() = nBegin;
+            pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, hashBegin));
+
+            while (pcursor->Valid() && !fFailed) {
+                std::pair<char, uint256> key;
+                if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= nEnd)
+                    break;
+
+                CDiskBlockIndex diskindex;
+                if (!pcursor->GetValue(diskindex)) {
+                    fFailed = true;
+                    error("%s: failed to read value", __func__);
+                    break;
+                }
+
+                uint256 hash;
+                if (diskindex.nHeaderCheck != 0) {
+                    // The key is the block hash, see CheckBlockIndexHashes
+                    hash = key.second;
+                    if (diskindex.nHeaderCheck != diskindex.ComputeHeaderCheck(hash)) {
+                        fFailed = true;
+                        error("%s: header check failed for %s", __func__, hash.ToString());
+                        break;
+                    }
+                } else {
+                    hash = diskindex.GetBlockHash();
+                    bool postfork = diskindex.nHeight >= consensusParams.BPQHeight;
+                    if (!CheckProofOfWork(hash, diskindex.nBits, postfork, consensusParams)) {
+                        fFailed = true;
+                        diskindex.phashBlock = &hash;
+                        error("%s: CheckProofOfWork failed: %s", __func__, diskindex.CBlockIndex::ToString());
+                        break;
+                    }
+                }
+
+                // The solution is only needed for the hash
+                std::vector<unsigned char>().swap(diskindex.nSolution);
+                vEntries.emplace_back(hash, std::move(diskindex));
+                pcursor->Next();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+    for (int i = 1; i < nThreads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    if (fFailed)
+        return false;
+
+    // Load mapBlockIndex
+    for (std::vector<std::pair<uint256, CDiskBlockIndex> >& vEntries : vSlices) {
+        boost::this_thread::interruption_point();
+        for (const std::pair<uint256, CDiskBlockIndex>& entry : vEntries) {
+            const CDiskBlockIndex& diskindex = entry.second;
+
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(entry.first);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nMajorVersion       = diskindex.nMajorVersion;
+            pindexNew->nMinorVersion       = diskindex.nMinorVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->hashWitnessMerkleRoot = diskindex.hashWitnessMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+        }
+        std::vector<std::pair<uint256, CDiskBlockIndex> >().swap(vEntries);
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::CheckBlockIndexHashes(const Consensus::Params& consensusParams, std::vector<uint256>& vUnchecked)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nMajorVersion       = diskindex.nMajorVersion;
-                pindexNew->nMinorVersion       = diskindex.nMinorVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->hashWitnessMerkleRoot = diskindex.hashWitnessMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nSolution      = diskindex.nSolution;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-
-                bool postfork = pindexNew->nHeight >= consensusParams.BPQHeight;
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, postfork, consensusParams))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX)
+            break;
 
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
-            }
+        CDiskBlockIndex diskindex;
+        if (!pcursor->GetValue(diskindex))
+            return error("%s: failed to read value", __func__);
+
+        if (diskindex.nHeaderCheck == 0) {
+            // Already hashed by LoadBlockIndexGuts
+            vUnchecked.push_back(key.second);
         } else {
-            break;
+            uint256 hash = diskindex.GetBlockHash();
+            if (hash != key.second)
+                return error("%s: block index entry %s has header hash %s", __func__, key.second.ToString(), hash.ToString());
+            bool postfork = diskindex.nHeight >= consensusParams.BPQHeight;
+            if (!CheckProofOfWork(hash, diskindex.nBits, postfork, consensusParams))
+                return error("%s: CheckProofOfWork failed for %s", __func__, hash.ToString());
         }
+        pcursor->Next();
     }
 
     return true;
 }
 
+bool CBlockTreeDB::WriteBlockIndex(const std::vector<CDiskBlockIndex>& blockinfo)
+{
+    CDBBatch batch(*this);
+    for (const CDiskBlockIndex& diskindex : blockinfo) {
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, diskindex.CBlockIndex::GetBlockHash()), diskindex);
+    }
+    return WriteBatch(batch);
+}
+
 namespace {
 
 //! Legacy class to deserialize pre-pertxout database entries without reindex.
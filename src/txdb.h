@@ -27,6 +27,14 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -dbflushthreads default
+static const int DEFAULT_DB_FLUSH_THREADS = 4;
+//! Estimated bytes a coin takes in a batch on top of its script
+static const size_t COIN_BATCH_ENTRY_SIZE = 48;
+//! Slices of the key space the block index is loaded in, see LoadBlockIndexGuts
+static const int BLOCK_INDEX_LOAD_SLICES = 64;
+//! Entries given a header check per cs_main lock, see ThreadCheckBlockIndexHashes
+static const size_t BLOCK_INDEX_UPGRADE_BATCH = 1000;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -78,11 +86,16 @@ public:
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! Like BatchWrite, but leaves mapCoins alone (see CCoinsViewCache::StartWriteBack)
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
     CCoinsViewCursor *Cursor() const override;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+private:
+    bool WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase);
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -116,7 +129,8 @@ public:
     CBlockTreeDB(const CBlockTreeDB&) = delete;
     CBlockTreeDB& operator=(const CBlockTreeDB&) = delete;
 
-    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<CDiskBlockIndex>& blockinfo);
+    bool ReadBlockIndex(const uint256& hash, CDiskBlockIndex& diskindex);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindexing);
@@ -125,7 +139,13 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    //! Load all block index entries, decoding and checking them on nThreads threads
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads = 1);
+    //! Check the header hash and proof of work of entries the load took on
+    //! trust, and return the ones written without a header check
+    bool CheckBlockIndexHashes(const Consensus::Params& consensusParams, std::vector<uint256>& vUnchecked);
+    //! Rewrite block index entries, leaving the block file information alone
+    bool WriteBlockIndex(const std::vector<CDiskBlockIndex>& blockinfo);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -42,7 +42,9 @@
 #include <warnings.h>
 
 #include <future>
+#include <list>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -155,7 +157,7 @@ public:
 
     bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock);
 
-    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex);
+    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW = true);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock);
 
     // Block (dis)connection on a given view:
@@ -216,6 +218,8 @@ bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fCheckBlockSolutions = DEFAULT_CHECK_BLOCK_SOLUTIONS;
+bool fCoinsWriteBack = DEFAULT_COINS_WRITEBACK;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -258,6 +262,86 @@ namespace {
 
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
+
+    /**
+     * Equihash solutions of block index entries, which CBlockIndex does not
+     * hold. Solutions of dirty entries are pinned until the next block index
+     * flush, so that it does not have to read them back. Besides those, a
+     * small LRU keeps the solutions of blocks near the best header, which are
+     * the ones peers ask for most. Guarded by cs_main.
+     */
+    class CBlockSolutionCache
+    {
+    private:
+        typedef std::list<std::pair<const CBlockIndex*, std::vector<unsigned char>>> RecentList;
+
+        std::map<const CBlockIndex*, std::vector<unsigned char>> mapUnflushed;
+        RecentList listRecent;
+        std::map<const CBlockIndex*, RecentList::iterator> mapRecent;
+
+    public:
+        void AddUnflushed(const CBlockIndex* pindex, std::vector<unsigned char> solution)
+        {
+            mapUnflushed[pindex] = std::move(solution);
+        }
+
+        bool IsUnflushed(const CBlockIndex* pindex) const
+        {
+            return mapUnflushed.count(pindex) > 0;
+        }
+
+        bool Get(const CBlockIndex* pindex, std::vector<unsigned char>& solution)
+        {
+            auto it = mapUnflushed.find(pindex);
+            if (it != mapUnflushed.end()) {
+                solution = it->second;
+                return true;
+            }
+            auto itRecent = mapRecent.find(pindex);
+            if (itRecent == mapRecent.end())
+                return false;
+            listRecent.splice(listRecent.begin(), listRecent, itRecent->second);
+            solution = itRecent->second->second;
+            return true;
+        }
+
+        void AddRecent(const CBlockIndex* pindex, std::vector<unsigned char> solution)
+        {
+            if (mapRecent.count(pindex))
+                return;
+            listRecent.emplace_front(pindex, std::move(solution));
+            mapRecent.emplace(pindex, listRecent.begin());
+            if (listRecent.size() > BLOCK_SOLUTION_CACHE_SIZE) {
+                mapRecent.erase(listRecent.back().first);
+                listRecent.pop_back();
+            }
+        }
+
+        /** All pinned solutions are on disk now; keep the recent ones in the LRU. */
+        template <typename Pred>
+        void Flushed(Pred fRecent)
+        {
+            for (auto& entry : mapUnflushed) {
+                if (fRecent(entry.first))
+                    AddRecent(entry.first, std::move(entry.second));
+            }
+            mapUnflushed.clear();
+        }
+
+        void Clear()
+        {
+            mapUnflushed.clear();
+            listRecent.clear();
+            mapRecent.clear();
+        }
+    };
+
+    CBlockSolutionCache blockSolutionCache;
+
+    bool IsRecentBlockSolution(const CBlockIndex* pindex)
+    {
+        return pindexBestHeader == nullptr || pindex->nHeight + (int)BLOCK_SOLUTION_CACHE_SIZE > pindexBestHeader->nHeight;
+    }
 } // anon namespace
 
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
@@ -282,15 +366,6 @@ std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
 
-enum FlushStateMode {
-    FLUSH_STATE_NONE,
-    FLUSH_STATE_IF_NEEDED,
-    FLUSH_STATE_PERIODIC,
-    FLUSH_STATE_ALWAYS
-};
-
-// See definition for documentation
-static bool FlushStateToDisk(const CChainParams& chainParams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight=0);
 static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight);
 static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
@@ -1117,7 +1192,7 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool fCheckSolution)
 {
     block.SetNull();
 
@@ -1135,26 +1210,36 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     }
 
     // Check Equihash solution
-    bool postfork = block.nMajorVersion != CBlockHeader::BITCOIN_MAJOR_VERSION;
-    if (postfork && !CheckEquihashSolution(&block, Params())) {
+    bool postfork = block.GetMajorVersion() != CBlockHeader::BITCOIN_MAJOR_VERSION;
+    if (fCheckSolution && postfork && !CheckEquihashSolution(&block, Params())) {
         return error("ReadBlockFromDisk: Errors in block header at %s (bad Equihash solution)", pos.ToString());
     }
     // Check the header
-    if (!CheckProofOfWork(block.GetHash(), block.nBits, postfork, consensusParams))
+    if (!CheckProofOfWork(block.GetHash(), block.GetBits(), postfork, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
 
     return true;
 }
 
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    return ReadBlockFromDisk(block, pos, consensusParams, true);
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     CDiskBlockPos blockPos;
+    bool fCheckSolution;
     {
         LOCK(cs_main);
         blockPos = pindex->GetBlockPos();
+        // A header that made it into the tree had its Equihash solution
+        // verified on acceptance, and the block hash compared below commits
+        // to that solution, so there is no need to verify it again.
+        fCheckSolution = fCheckBlockSolutions || !pindex->IsValid(BLOCK_VALID_TREE);
     }
 
-    if (!ReadBlockFromDisk(block, blockPos, consensusParams))
+    if (!ReadBlockFromDisk(block, blockPos, consensusParams, fCheckSolution))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1162,6 +1247,115 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+static bool ReadBlockHeaderFromDisk(CBlockHeader& header, const CDiskBlockPos& pos)
+{
+    header.SetNull();
+
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("ReadBlockHeaderFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+    // A block on disk starts with its header
+    try {
+        filein >> header;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
+bool GetBlockSolution(const CBlockIndex* pindex, std::vector<unsigned char>& solution)
+{
+    AssertLockHeld(cs_main);
+
+    if (blockSolutionCache.Get(pindex, solution))
+        return true;
+
+    CDiskBlockIndex diskindex;
+    if (pblocktree->ReadBlockIndex(pindex->GetBlockHash(), diskindex)) {
+        solution.swap(diskindex.nSolution);
+    } else if (pindex->nStatus & BLOCK_HAVE_DATA) {
+        CBlockHeader header;
+        if (!ReadBlockHeaderFromDisk(header, pindex->GetBlockPos()))
+            return false;
+        if (header.GetHash() != pindex->GetBlockHash())
+            return error("%s: GetHash() doesn't match index for %s at %s", __func__,
+                    pindex->ToString(), pindex->GetBlockPos().ToString());
+        solution = header.GetSolution();
+    } else {
+        return error("%s: no solution stored for %s", __func__, pindex->ToString());
+    }
+
+    if (IsRecentBlockSolution(pindex))
+        blockSolutionCache.AddRecent(pindex, solution);
+    return true;
+}
+
+bool GetBlockHeader(const CBlockIndex* pindex, CBlockHeader& header)
+{
+    std::vector<unsigned char> solution;
+    if (!GetBlockSolution(pindex, solution))
+        return false;
+    header = pindex->GetBlockHeaderWithoutSolution();
+    header.SetSolution(std::move(solution));
+    return true;
+}
+
+bool GetBlockHeaders(const std::vector<const CBlockIndex*>& vIndex, std::vector<CBlockHeader>& vHeaders)
+{
+    AssertLockNotHeld(cs_main);
+
+    vHeaders.clear();
+    vHeaders.reserve(vIndex.size());
+    std::vector<size_t> vMissing;
+    {
+        LOCK(cs_main);
+        std::vector<unsigned char> solution;
+        for (const CBlockIndex* pindex : vIndex) {
+            vHeaders.push_back(pindex->GetBlockHeaderWithoutSolution());
+            if (blockSolutionCache.Get(pindex, solution))
+                vHeaders.back().SetSolution(solution);
+            else
+                vMissing.push_back(vHeaders.size() - 1);
+        }
+    }
+
+    // Block index entries are not deleted while running and the block tree
+    // DB can be read concurrently. Only entries without a DB record take
+    // cs_main again.
+    for (size_t i : vMissing) {
+        CDiskBlockIndex diskindex;
+        if (pblocktree->ReadBlockIndex(vIndex[i]->GetBlockHash(), diskindex)) {
+            vHeaders[i].SetSolution(std::move(diskindex.nSolution));
+        } else {
+            LOCK(cs_main);
+            std::vector<unsigned char> solution;
+            if (!GetBlockSolution(vIndex[i], solution))
+                return false;
+            vHeaders[i].SetSolution(std::move(solution));
+        }
+    }
+    return true;
+}
+
+/** Queue pindex for the next block index flush, pinning the solution of its block until then. */
+static void MarkBlockIndexDirty(CBlockIndex* pindex, const CBlockHeader& block)
+{
+    setDirtyBlockIndex.insert(pindex);
+    if (!blockSolutionCache.IsUnflushed(pindex))
+        blockSolutionCache.AddUnflushed(pindex, block.GetSolution());
+}
+
+/** Queue pindex for the next block index flush, when its block is not at hand. */
+static void MarkBlockIndexDirty(CBlockIndex* pindex)
+{
+    setDirtyBlockIndex.insert(pindex);
+    std::vector<unsigned char> solution;
+    if (!blockSolutionCache.IsUnflushed(pindex) && GetBlockSolution(pindex, solution))
+        blockSolutionCache.AddUnflushed(pindex, std::move(solution));
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     int halvings = nHeight / consensusParams.nSubsidyHalvingInterval;
@@ -1318,7 +1512,7 @@ void CChainState::InvalidBlockFound(CBlockIndex *pindex, const CValidationState
     if (!state.CorruptionPossible()) {
         pindex->nStatus |= BLOCK_FAILED_VALID;
         g_failed_blocks.insert(pindex);
-        setDirtyBlockIndex.insert(pindex);
+        MarkBlockIndexDirty(pindex);
         setBlockIndexCandidates.erase(pindex);
         InvalidChainFound(pindex);
     }
@@ -1666,7 +1860,7 @@ void static FlushBlockFile(bool fFinalize = false)
 
 static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState& state, CBlockIndex* pindex, const CChainParams& chainparams)
+static bool WriteUndoDataForBlock(const CBlock& block, const CBlockUndo& blockundo, CValidationState& state, CBlockIndex* pindex, const CChainParams& chainparams)
 {
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
@@ -1679,7 +1873,7 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
         // update nUndoPos in block index
         pindex->nUndoPos = _pos.nPos;
         pindex->nStatus |= BLOCK_HAVE_UNDO;
-        setDirtyBlockIndex.insert(pindex);
+        MarkBlockIndexDirty(pindex, block);
     }
 
     return true;
@@ -1712,6 +1906,99 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+namespace {
+
+/**
+ * Closure representing the context-free proof of work checks of one header:
+ * its Equihash solution and the hash against the claimed target.
+ *
+ * A failure lowers the shared first invalid position instead of failing the
+ * check, so that the queue still runs the checks of all earlier headers and
+ * the first invalid one is known without checking any header again. Checks of
+ * headers after a known failure are skipped.
+ */
+class CHeaderPOWCheck
+{
+private:
+    const CBlockHeader* pheader;
+    const CChainParams* pparams;
+    size_t nPos;
+    std::atomic<size_t>* pnFirstInvalid;
+
+public:
+    CHeaderPOWCheck() : pheader(nullptr), pparams(nullptr), nPos(0), pnFirstInvalid(nullptr) {}
+    CHeaderPOWCheck(const CBlockHeader& header, const CChainParams& params, size_t nPosIn, std::atomic<size_t>& nFirstInvalid) :
+        pheader(&header), pparams(&params), nPos(nPosIn), pnFirstInvalid(&nFirstInvalid) {}
+
+    bool operator()()
+    {
+        size_t nFirstInvalid = pnFirstInvalid->load(std::memory_order_relaxed);
+        if (nPos > nFirstInvalid)
+            return true;
+        bool postfork = pheader->GetMajorVersion() != CBlockHeader::BITCOIN_MAJOR_VERSION;
+        if ((postfork && !CheckEquihashSolution(pheader, *pparams)) ||
+            !CheckProofOfWork(pheader->GetHash(), pheader->GetBits(), postfork, pparams->GetConsensus())) {
+            while (nPos < nFirstInvalid && !pnFirstInvalid->compare_exchange_weak(nFirstInvalid, nPos)) {}
+        }
+        return true;
+    }
+
+    void swap(CHeaderPOWCheck& check)
+    {
+        std::swap(pheader, check.pheader);
+        std::swap(pparams, check.pparams);
+        std::swap(nPos, check.nPos);
+        std::swap(pnFirstInvalid, check.pnFirstInvalid);
+    }
+};
+
+} // namespace
+
+// Equihash checks are expensive, so hand them out to workers a few at a time.
+static CCheckQueue<CHeaderPOWCheck> headercheckqueue(4);
+
+void ThreadHeaderCheck() {
+    RenameThread("bitcoin-headerch");
+    headercheckqueue.Thread();
+}
+
+void ThreadCheckBlockIndexHashes()
+{
+    RenameThread("bitcoin-idxcheck");
+
+    std::vector<uint256> vUnchecked;
+    if (!pblocktree->CheckBlockIndexHashes(Params().GetConsensus(), vUnchecked)) {
+        AbortNode("Corrupted block index", _("Corrupted block database detected") + ".\n" + _("Please restart with -reindex to recover."));
+        return;
+    }
+
+    // Add a header check to entries written before there were any, so the
+    // next start does not have to hash them. Dirty entries get one when they
+    // are flushed.
+    for (size_t i = 0; i < vUnchecked.size(); i += BLOCK_INDEX_UPGRADE_BATCH) {
+        boost::this_thread::interruption_point();
+        LOCK(cs_main);
+        std::vector<CDiskBlockIndex> vBlocks;
+        std::vector<unsigned char> solution;
+        for (size_t j = i; j < std::min(i + BLOCK_INDEX_UPGRADE_BATCH, vUnchecked.size()); j++) {
+            BlockMap::iterator mi = mapBlockIndex.find(vUnchecked[j]);
+            if (mi == mapBlockIndex.end() || setDirtyBlockIndex.count(mi->second))
+                continue;
+            if (!GetBlockSolution(mi->second, solution)) {
+                AbortNode("Failed to read block solution");
+                return;
+            }
+            vBlocks.emplace_back(mi->second, solution);
+        }
+        if (!pblocktree->WriteBlockIndex(vBlocks)) {
+            AbortNode("Failed to write to block index database");
+            return;
+        }
+    }
+
+    LogPrintf("%s: block index checked, %u entries upgraded\n", __func__, vUnchecked.size());
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2026,12 +2313,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (fJustCheck)
         return true;
 
-    if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
+    if (!WriteUndoDataForBlock(block, blockundo, state, pindex, chainparams))
         return false;
 
     if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
-        setDirtyBlockIndex.insert(pindex);
+        MarkBlockIndexDirty(pindex, block);
     }
 
     if (!WriteTxIndexDataForBlock(block, state, pindex))
@@ -2050,18 +2337,80 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     return true;
 }
 
+namespace {
+//! Writes the coins taken by CCoinsViewCache::StartWriteBack, see WriteBackCoins
+std::thread threadCoinsWriteBack;
+std::atomic<bool> fCoinsWriteBackRunning(false);
+std::atomic<bool> fCoinsWriteBackFailed(false);
+}
+
+void FinishCoinsWriteBack()
+{
+    AssertLockHeld(cs_main);
+    if (threadCoinsWriteBack.joinable())
+        threadCoinsWriteBack.join();
+    if (pcoinsTip && pcoinsTip->HaveWriteBack())
+        pcoinsTip->EndWriteBack();
+}
+
+/**
+ * Write the modified coins of pcoinsTip to the coins database, keeping them
+ * in the cache. Unless fSync, the write runs in the background; lookups see
+ * the written coins through pcoinsTip meanwhile, and the next write back
+ * waits for it.
+ */
+static bool WriteBackCoins(CValidationState& state, bool fSync)
+{
+    AssertLockHeld(cs_main);
+    FinishCoinsWriteBack();
+    if (fCoinsWriteBackFailed)
+        return AbortNode(state, "Failed to write to coin database");
+
+    std::shared_ptr<const CCoinsMap> mapCoins = pcoinsTip->StartWriteBack();
+    // Only the dirty coins are written, see the estimate in FlushStateToDisk
+    if (!CheckDiskSpace(48 * 2 * 2 * mapCoins->size())) {
+        pcoinsTip->CancelWriteBack();
+        return state.Error("out of disk space");
+    }
+    uint256 hashBlock = pcoinsTip->GetBestBlock();
+    if (fSync) {
+        bool fOk = pcoinsdbview->WriteCoins(*mapCoins, hashBlock);
+        pcoinsTip->EndWriteBack();
+        if (!fOk)
+            return AbortNode(state, "Failed to write to coin database");
+        return true;
+    }
+
+    fCoinsWriteBackRunning = true;
+    threadCoinsWriteBack = std::thread([mapCoins, hashBlock] {
+        RenameThread("bitcoin-coinswb");
+        try {
+            if (!pcoinsdbview->WriteCoins(*mapCoins, hashBlock)) {
+                fCoinsWriteBackFailed = true;
+                AbortNode("Failed to write to coin database");
+            }
+        } catch (const std::runtime_error& e) {
+            fCoinsWriteBackFailed = true;
+            AbortNode(std::string("System error while writing back coins: ") + e.what());
+        }
+        fCoinsWriteBackRunning = false;
+    });
+    return true;
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed depending on the mode we're called with
  * if they're too large, if it's been a while since the last write,
  * or always and in all cases if we're in prune mode and are deleting files.
  */
-bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight) {
+bool FlushStateToDisk(const CChainParams& chainparams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight) {
     int64_t nMempoolUsage = mempool.DynamicMemoryUsage();
     LOCK(cs_main);
     static int64_t nLastWrite = 0;
     static int64_t nLastFlush = 0;
     static int64_t nLastSetChain = 0;
+    static int64_t nLastWriteBack = 0;
     std::set<int> setFilesToPrune;
     bool fFlushForPrune = false;
     bool fDoFullFlush = false;
@@ -2095,21 +2444,29 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         if (nLastSetChain == 0) {
             nLastSetChain = nNow;
         }
+        if (nLastWriteBack == 0) {
+            nLastWriteBack = nNow;
+        }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // Blocks left free in the coins pool by evicted entries are reused before new chunks are
+        // allocated, so they do not count against the limit; EvictClean compacts the pool when too many are.
+        int64_t cacheSize = pcoinsTip->EntriesMemoryUsage() + pcoinsTip->WriteBackMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
-        // The cache is over the limit, we have to write now.
-        bool fCacheCritical = mode == FLUSH_STATE_IF_NEEDED && cacheSize > nTotalSpace;
+        // The cache is over the limit, we have to write now. The coins of a running write back are
+        // released once it is done, waiting for it here would only make it synchronous.
+        bool fCacheCritical = mode == FLUSH_STATE_IF_NEEDED && cacheSize - (int64_t)pcoinsTip->WriteBackMemoryUsage() > nTotalSpace;
         // It's been a while since we wrote the block index to disk. Do this frequently, so we don't need to redownload after a crash.
         bool fPeriodicWrite = mode == FLUSH_STATE_PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
         fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        // Writing the cache back without emptying it is cheap enough to be done often.
+        bool fPeriodicWriteBack = fCoinsWriteBack && mode == FLUSH_STATE_PERIODIC && !fCoinsWriteBackRunning && nNow > nLastWriteBack + (int64_t)COINS_WRITEBACK_INTERVAL * 1000000;
         // Write blocks and block index to disk.
-        if (fDoFullFlush || fPeriodicWrite) {
+        if (fDoFullFlush || fPeriodicWrite || fPeriodicWriteBack) {
             // Depend on nMinDiskSpace to ensure we can write block index
             if (!CheckDiskSpace(0))
                 return state.Error("out of disk space");
@@ -2123,15 +2480,20 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                     vFiles.push_back(std::make_pair(*it, &vinfoBlockFile[*it]));
                     setDirtyFileInfo.erase(it++);
                 }
-                std::vector<const CBlockIndex*> vBlocks;
+                std::vector<CDiskBlockIndex> vBlocks;
                 vBlocks.reserve(setDirtyBlockIndex.size());
+                std::vector<unsigned char> solution;
                 for (std::set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
-                    vBlocks.push_back(*it);
+                    if (!GetBlockSolution(*it, solution)) {
+                        return AbortNode(state, "Failed to read block solution");
+                    }
+                    vBlocks.emplace_back(*it, solution);
                     setDirtyBlockIndex.erase(it++);
                 }
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
+                blockSolutionCache.Flushed(IsRecentBlockSolution);
             }
             // Finally remove any pruned files
             if (fFlushForPrune)
@@ -2139,7 +2501,19 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
-        if (fDoFullFlush && !pcoinsTip->GetBestBlock().IsNull()) {
+        if (fCoinsWriteBack) {
+            // Write backs which do not have to happen now are skipped while one is running.
+            bool fSync = mode == FLUSH_STATE_ALWAYS || fCacheCritical || fFlushForPrune;
+            if ((fDoFullFlush || fPeriodicWriteBack) && (fSync || !fCoinsWriteBackRunning) && !pcoinsTip->GetBestBlock().IsNull()) {
+                if (!WriteBackCoins(state, fSync))
+                    return false;
+                // Keep the cache warm, only dropping coins which were not used lately
+                if (pcoinsTip->EntriesMemoryUsage() > (size_t)(9 * nTotalSpace) / 10)
+                    pcoinsTip->EvictClean((3 * nTotalSpace) / 4);
+                nLastFlush = nNow;
+                nLastWriteBack = nNow;
+            }
+        } else if (fDoFullFlush && !pcoinsTip->GetBestBlock().IsNull()) {
             // Typical Coin structures on disk are around 48 bytes in size.
             // Pushing a new one to the database can cause it to be written
             // twice (once in the log, and once in the tables). This is already
@@ -2761,14 +3135,14 @@ bool CChainState::InvalidateBlock(CValidationState& state, const CChainParams& c
     // (note this may not be all descendants).
     while (pindex_was_in_chain && invalid_walk_tip != pindex) {
         invalid_walk_tip->nStatus |= BLOCK_FAILED_CHILD;
-        setDirtyBlockIndex.insert(invalid_walk_tip);
+        MarkBlockIndexDirty(invalid_walk_tip);
         setBlockIndexCandidates.erase(invalid_walk_tip);
         invalid_walk_tip = invalid_walk_tip->pprev;
     }
 
     // Mark the block itself as invalid.
     pindex->nStatus |= BLOCK_FAILED_VALID;
-    setDirtyBlockIndex.insert(pindex);
+    MarkBlockIndexDirty(pindex);
     setBlockIndexCandidates.erase(pindex);
     g_failed_blocks.insert(pindex);
 
@@ -2804,7 +3178,7 @@ bool CChainState::ResetBlockFailureFlags(CBlockIndex *pindex) {
     while (it != mapBlockIndex.end()) {
         if (!it->second->IsValid() && it->second->GetAncestor(nHeight) == pindex) {
             it->second->nStatus &= ~BLOCK_FAILED_MASK;
-            setDirtyBlockIndex.insert(it->second);
+            MarkBlockIndexDirty(it->second);
             if (it->second->IsValid(BLOCK_VALID_TRANSACTIONS) && it->second->nChainTx && setBlockIndexCandidates.value_comp()(chainActive.Tip(), it->second)) {
                 setBlockIndexCandidates.insert(it->second);
             }
@@ -2821,7 +3195,7 @@ bool CChainState::ResetBlockFailureFlags(CBlockIndex *pindex) {
     while (pindex != nullptr) {
         if (pindex->nStatus & BLOCK_FAILED_MASK) {
             pindex->nStatus &= ~BLOCK_FAILED_MASK;
-            setDirtyBlockIndex.insert(pindex);
+            MarkBlockIndexDirty(pindex);
         }
         pindex = pindex->pprev;
     }
@@ -2847,7 +3221,7 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
     pindexNew->nSequenceId = 0;
     BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
-    BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
+    BlockMap::iterator miPrev = mapBlockIndex.find(block.GetHashPrevBlock());
     if (miPrev != mapBlockIndex.end())
     {
         pindexNew->pprev = (*miPrev).second;
@@ -2860,7 +3234,7 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
     if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork)
         pindexBestHeader = pindexNew;
 
-    setDirtyBlockIndex.insert(pindexNew);
+    MarkBlockIndexDirty(pindexNew, block);
 
     return pindexNew;
 }
@@ -2878,7 +3252,7 @@ bool CChainState::ReceivedBlockTransactions(const CBlock &block, CValidationStat
         pindexNew->nStatus |= BLOCK_OPT_WITNESS;
     }
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
-    setDirtyBlockIndex.insert(pindexNew);
+    MarkBlockIndexDirty(pindexNew, block);
 
     if (pindexNew->pprev == nullptr || pindexNew->pprev->nChainTx) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
@@ -3004,22 +3378,22 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
 
 static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
 {
-    if (block.nMajorVersion != CBlockHeader::BITCOIN_MAJOR_VERSION &&
-        block.nMajorVersion != CBlockHeader::BPQ_MAJOR_VERSION)
+    if (block.GetMajorVersion() != CBlockHeader::BITCOIN_MAJOR_VERSION &&
+        block.GetMajorVersion() != CBlockHeader::BPQ_MAJOR_VERSION)
     {
-        LogPrintf("CheckBlockHeader(): Invalid block MajorVersion: %d\n", block.nMajorVersion);
+        LogPrintf("CheckBlockHeader(): Invalid block MajorVersion: %d\n", block.GetMajorVersion());
         return state.DoS(100, error("CheckBlockHeader(): Invalid block MajorVersion"),
                          REJECT_INVALID, "invalid-major-version");
     }
 
-    if (block.nSolution.size() != consensusParams.nSolutionSize)
+    if (block.GetSolution().size() != consensusParams.nSolutionSize)
     {
         return state.DoS(100, error("CheckBlockHeader(): Invalid block solution size"),
                          REJECT_INVALID, "invalid-sol-size");
     }
 
     // Check Equihash solution is valid
-    bool postfork = block.nMajorVersion != CBlockHeader::BITCOIN_MAJOR_VERSION;
+    bool postfork = block.GetMajorVersion() != CBlockHeader::BITCOIN_MAJOR_VERSION;
 
     if (fCheckPOW && postfork && !CheckEquihashSolution(&block, Params())) {
         LogPrintf("CheckBlockHeader(): Equihash solution invalid\n");
@@ -3028,7 +3402,7 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     }
 
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetHash(), block.nBits, postfork, consensusParams))
+    if (fCheckPOW && !CheckProofOfWork(block.GetHash(), block.GetBits(), postfork, consensusParams))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     return true;
@@ -3051,7 +3425,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (fCheckMerkleRoot) {
         bool mutated;
         uint256 hashMerkleRoot2 = BlockMerkleRoot(block, &mutated);
-        if (block.hashMerkleRoot != hashMerkleRoot2)
+        if (block.GetHashMerkleRoot() != hashMerkleRoot2)
             return state.DoS(100, false, REJECT_INVALID, "bad-txnmrklroot", true, "hashMerkleRoot mismatch");
 
         // Check for merkle tree malleability (CVE-2012-2459): repeating sequences
@@ -3069,7 +3443,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 
     // Size limits
 
-    if (block.nMajorVersion > CBlock::BITCOIN_MAJOR_VERSION)
+    if (block.GetMajorVersion() > CBlock::BITCOIN_MAJOR_VERSION)
     {
         if (block.vtx.empty() || block.vtx.size() * WITNESS_SCALE_FACTOR > MAX_BLOCK_WEIGHT)
             return state.DoS(100, false, REJECT_INVALID, "bad-blk-length", false, "size limits failed");
@@ -3094,7 +3468,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 
     // Check BPQ transactions
     if (fCheckBPQTx) {
-        if (block.nMajorVersion > CBlock::BITCOIN_MAJOR_VERSION)
+        if (block.GetMajorVersion() > CBlock::BITCOIN_MAJOR_VERSION)
         {
             for (const auto& ptx : block.vtx)
             {
@@ -3144,7 +3518,7 @@ static int GetWitnessCommitmentIndex(const CBlock& block)
 
 void UpdateUncommittedBlockStructures(CBlock& block, const CBlockIndex* pindexPrev, const Consensus::Params& consensusParams)
 {
-    if (block.nMajorVersion != CBlock::BITCOIN_MAJOR_VERSION)
+    if (block.GetMajorVersion() != CBlock::BITCOIN_MAJOR_VERSION)
         return;
 
     int commitpos = GetWitnessCommitmentIndex(block);
@@ -3161,7 +3535,7 @@ std::vector<unsigned char> GenerateCoinbaseCommitment(CBlock& block, const CBloc
 {
     std::vector<unsigned char> commitment;
 
-    if (block.nMajorVersion != CBlock::BITCOIN_MAJOR_VERSION)
+    if (block.GetMajorVersion() != CBlock::BITCOIN_MAJOR_VERSION)
         return commitment;
 
     int commitpos = GetWitnessCommitmentIndex(block);
@@ -3205,15 +3579,15 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationSta
 
     const int nHeight = pindexPrev->nHeight + 1;
 
-    if (nHeight < params.GetConsensus().BPQHeight && block.nMajorVersion != CBlockHeader::BITCOIN_MAJOR_VERSION)
+    if (nHeight < params.GetConsensus().BPQHeight && block.GetMajorVersion() != CBlockHeader::BITCOIN_MAJOR_VERSION)
         return state.DoS(100, error("%s: invalid major version for height %d", __func__, nHeight), REJECT_INVALID, "bad-majorversion");
-    if (nHeight >= params.GetConsensus().BPQHeight && block.nMajorVersion != CBlockHeader::BPQ_MAJOR_VERSION)
+    if (nHeight >= params.GetConsensus().BPQHeight && block.GetMajorVersion() != CBlockHeader::BPQ_MAJOR_VERSION)
         return state.DoS(100, error("%s: invalid major version for height %d", __func__, nHeight), REJECT_INVALID, "bad-majorversion");
 
     // Check proof of work
     const Consensus::Params& consensusParams = params.GetConsensus();
     uint32_t nNextBits = GetNextWorkRequired(pindexPrev, &block, consensusParams);
-    if (block.nBits != nNextBits)
+    if (block.GetBits() != nNextBits)
         return state.DoS(100, false, REJECT_INVALID, "bad-diffbits", false, "incorrect proof of work");
 
     // Check against checkpoints
@@ -3241,11 +3615,11 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationSta
 
     // Reject outdated version blocks when 95% (75% on testnet) of the network has upgraded:
     // check for version 2, 3 and 4 upgrades
-    if((block.nMinorVersion < 2 && nHeight >= consensusParams.BIP34Height) ||
-       (block.nMinorVersion < 3 && nHeight >= consensusParams.BIP66Height) ||
-       (block.nMinorVersion < 4 && nHeight >= consensusParams.BIP65Height))
-            return state.Invalid(false, REJECT_OBSOLETE, strprintf("bad-version(0x%08x)", block.nMinorVersion),
-                                 strprintf("rejected nVersion=0x%08x block", block.nMinorVersion));
+    if((block.GetMinorVersion() < 2 && nHeight >= consensusParams.BIP34Height) ||
+       (block.GetMinorVersion() < 3 && nHeight >= consensusParams.BIP66Height) ||
+       (block.GetMinorVersion() < 4 && nHeight >= consensusParams.BIP65Height))
+            return state.Invalid(false, REJECT_OBSOLETE, strprintf("bad-version(0x%08x)", block.GetMinorVersion()),
+                                 strprintf("rejected nVersion=0x%08x block", block.GetMinorVersion()));
     return true;
 }
 
@@ -3314,7 +3688,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     //   multiple, the last one is used.
     bool fHaveWitness = false;
 
-    if (block.nMajorVersion == CBlock::BITCOIN_MAJOR_VERSION)
+    if (block.GetMajorVersion() == CBlock::BITCOIN_MAJOR_VERSION)
     {
         if (VersionBitsState(pindexPrev, consensusParams, Consensus::DEPLOYMENT_SEGWIT, versionbitscache) == THRESHOLD_ACTIVE) {
             int commitpos = GetWitnessCommitmentIndex(block);
@@ -3342,7 +3716,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
         bool malleated = false;
         uint256 hashWitness = BlockWitnessMerkleRoot(block, &malleated);
 
-        if (memcmp(hashWitness.begin(), block.hashWitnessMerkleRoot.begin(), 32)) {
+        if (memcmp(hashWitness.begin(), block.GetHashWitnessMerkleRoot().begin(), 32)) {
             return state.DoS(100, false, REJECT_INVALID, "bad-witness-merkle-match", true, strprintf("%s : witness merkle commitment mismatch", __func__));
         }
 
@@ -3365,7 +3739,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     // large by filling up the coinbase witness, which doesn't change
     // the block hash, so we couldn't mark the block as permanently
     // failed).
-    if (block.nMajorVersion > CBlock::BITCOIN_MAJOR_VERSION)
+    if (block.GetMajorVersion() > CBlock::BITCOIN_MAJOR_VERSION)
     {
         if (GetBlockWeight(block, consensusParams) > MAX_BLOCK_WEIGHT) {
             return state.DoS(100, false, REJECT_INVALID, "bad-blk-weight", false,
@@ -3376,7 +3750,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3395,12 +3769,12 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPOW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
         CBlockIndex* pindexPrev = nullptr;
-        BlockMap::iterator mi = mapBlockIndex.find(block.hashPrevBlock);
+        BlockMap::iterator mi = mapBlockIndex.find(block.GetHashPrevBlock());
         if (mi == mapBlockIndex.end())
             return state.DoS(10, error("%s: prev block not found", __func__), 0, "prev-blk-not-found");
         pindexPrev = (*mi).second;
@@ -3416,7 +3790,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
                     CBlockIndex* invalid_walk = pindexPrev;
                     while (invalid_walk != failedit) {
                         invalid_walk->nStatus |= BLOCK_FAILED_CHILD;
-                        setDirtyBlockIndex.insert(invalid_walk);
+                        MarkBlockIndexDirty(invalid_walk);
                         invalid_walk = invalid_walk->pprev;
                     }
                     return state.DoS(100, error("%s: prev block invalid", __func__), REJECT_INVALID, "bad-prevblk");
@@ -3436,14 +3810,48 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
 }
 
 // Exposed wrapper for AcceptBlockHeader
+/**
+ * Verify the proof of work of all headers not in mapBlockIndex yet, in
+ * parallel on the header check threads and without holding cs_main.
+ * Returns the position of the first header with invalid proof of work, or
+ * headers.size() if there is none.
+ */
+static size_t CheckNewHeadersPOW(const std::vector<CBlockHeader>& headers, const CChainParams& chainparams)
+{
+    std::atomic<size_t> nFirstInvalid(headers.size());
+    std::vector<CHeaderPOWCheck> vChecks;
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < headers.size(); i++) {
+            if (!mapBlockIndex.count(headers[i].GetHash()))
+                vChecks.emplace_back(headers[i], chainparams, i, nFirstInvalid);
+        }
+    }
+
+    if (nScriptCheckThreads <= 1 || vChecks.size() <= 1) {
+        for (CHeaderPOWCheck& check : vChecks)
+            check();
+    } else {
+        CCheckQueueControl<CHeaderPOWCheck> control(&headercheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+    return nFirstInvalid;
+}
+
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+    // The proof of work of the headers before nFirstInvalid is known to be
+    // valid. That header itself is checked in full again below, which fails
+    // it with the proper validation state.
+    const size_t nFirstInvalid = CheckNewHeadersPOW(headers, chainparams);
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex, i >= nFirstInvalid)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -3526,7 +3934,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
         !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
-            setDirtyBlockIndex.insert(pindex);
+            MarkBlockIndexDirty(pindex, block);
         }
         return error("%s: %s", __func__, FormatStateMessage(state));
     }
@@ -3644,7 +4052,7 @@ void PruneOneBlockFile(const int fileNumber)
             pindex->nFile = 0;
             pindex->nDataPos = 0;
             pindex->nUndoPos = 0;
-            setDirtyBlockIndex.insert(pindex);
+            MarkBlockIndexDirty(pindex);
 
             // Prune from mapBlocksUnlinked -- any block we prune would have
             // to be downloaded again in order to consider its chain, at which
@@ -3836,7 +4244,9 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
 
 bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlockTreeDB& blocktree)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash){ return this->InsertBlockIndex(hash); }))
+    // Nothing else runs yet, use as many threads as -par allows for scripts
+    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash){ return this->InsertBlockIndex(hash); },
+                                      std::max(nScriptCheckThreads, 1)))
         return false;
 
     boost::this_thread::interruption_point();
@@ -3871,7 +4281,7 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
         }
         if (!(pindex->nStatus & BLOCK_FAILED_MASK) && pindex->pprev && (pindex->pprev->nStatus & BLOCK_FAILED_MASK)) {
             pindex->nStatus |= BLOCK_FAILED_CHILD;
-            setDirtyBlockIndex.insert(pindex);
+            MarkBlockIndexDirty(pindex);
         }
         if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS) && (pindex->nChainTx || pindex->pprev == nullptr))
             setBlockIndexCandidates.insert(pindex);
@@ -4225,7 +4635,7 @@ bool CChainState::RewindBlockIndex(const CChainParams& params)
             pindexIter->nChainTx = 0;
             pindexIter->nSequenceId = 0;
             // Make sure it gets written.
-            setDirtyBlockIndex.insert(pindexIter);
+            MarkBlockIndexDirty(pindexIter);
             // Update indexes
             setBlockIndexCandidates.erase(pindexIter);
             std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> ret = mapBlocksUnlinked.equal_range(pindexIter->pprev);
@@ -4282,6 +4692,8 @@ void CChainState::UnloadBlockIndex() {
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    // the write back thread uses pcoinsTip and pcoinsdbview, which go next
+    FinishCoinsWriteBack();
     chainActive.SetTip(nullptr);
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
@@ -4291,6 +4703,7 @@ void UnloadBlockIndex()
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
+    blockSolutionCache.Clear();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
         warningcache[b].clear();
@@ -4410,11 +4823,11 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
 
                 // detect out of order blocks, and store them for later
                 uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.GetHashPrevBlock()) == mapBlockIndex.end()) {
                     LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
+                            block.GetHashPrevBlock().ToString());
                     if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                        mapBlocksUnknownParent.insert(std::make_pair(block.GetHashPrevBlock(), *dbp));
                     continue;
                 }
 
@@ -4613,7 +5026,7 @@ void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
                 }
             }
         }
-        // assert(pindex->GetBlockHash() == pindex->GetBlockHeader().GetHash()); // Perhaps too slow
+        // assert(pindex->GetBlockHash() == CDiskBlockIndex(pindex, solution).GetBlockHash()); // Perhaps too slow
         // End: actual consistency checks.
 
         // Try descending into the first subnode.
@@ -90,6 +90,8 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 2000;
+/** Number of blocks below the best header whose Equihash solutions are kept in memory. */
+static const unsigned int BLOCK_SOLUTION_CACHE_SIZE = 1024;
 /** Maximum depth of blocks we're willing to serve as compact blocks to peers
  *  when requested. For older blocks, a regular BLOCK response will be sent. */
 static const int MAX_CMPCTBLOCK_DEPTH = 5;
@@ -104,6 +106,8 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Time to wait (in seconds) between writing back the coins cache with -coinswriteback. */
+static const unsigned int COINS_WRITEBACK_INTERVAL = 60;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 /** Average delay between local address broadcasts in seconds. */
@@ -132,6 +136,10 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 /** Default for -permitbaremultisig */
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -checkblocksolutions */
+static const bool DEFAULT_CHECK_BLOCK_SOLUTIONS = false;
+/** Default for -coinswriteback */
+static const bool DEFAULT_COINS_WRITEBACK = false;
 static const bool DEFAULT_TXINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
@@ -177,6 +185,10 @@ extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Re-verify the Equihash solution of blocks read from disk even when their header was already validated */
+extern bool fCheckBlockSolutions;
+/** Write the coins cache back to disk in the background and keep it warm, instead of emptying it on flushes */
+extern bool fCoinsWriteBack;
 extern size_t nCoinCacheUsage;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
@@ -276,6 +288,10 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header proof of work checking thread */
+void ThreadHeaderCheck();
+/** Check the block index entries which were loaded without hashing their headers */
+void ThreadCheckBlockIndexHashes();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -300,8 +316,20 @@ void PruneOneBlockFile(const int fileNumber);
  */
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
+enum FlushStateMode {
+    FLUSH_STATE_NONE,
+    FLUSH_STATE_IF_NEEDED,
+    FLUSH_STATE_PERIODIC,
+    FLUSH_STATE_ALWAYS
+};
+
+/** Update the on-disk chain state as far as mode calls for, see the definition */
+bool FlushStateToDisk(const CChainParams& chainparams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight = 0);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/** Wait for the background coins write, if any, and release its coins. Call
+ * before resetting pcoinsTip or pcoinsdbview. */
+void FinishCoinsWriteBack();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
 /** Prune block files up to a given height */
@@ -400,6 +428,14 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Same without cs_main, for a caller that looked up the position and whether the Equihash solution needs checking */
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool fCheckSolution);
+
+/** CBlockIndex does not keep the Equihash solution; fetch it, or the full header, on demand. Requires cs_main. */
+bool GetBlockSolution(const CBlockIndex* pindex, std::vector<unsigned char>& solution);
+bool GetBlockHeader(const CBlockIndex* pindex, CBlockHeader& header);
+/** Fetch the headers of several entries at once, reading solutions that are not in memory without cs_main, which must not be held. */
+bool GetBlockHeaders(const std::vector<const CBlockIndex*>& vIndex, std::vector<CBlockHeader>& vHeaders);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -157,12 +157,27 @@ static bool DecryptKey(const CKeyingMaterial& vMasterKey, const std::vector<unsi
 	}
 }
 
+//! Checks that a crypted key decrypts to the given public key. XMSS secrets
+//! are checked against the public key prefix, without rebuilding the hash tree.
+static bool CheckCryptedKey(const CKeyingMaterial& vMasterKey, const std::vector<unsigned char>& vchCryptedSecret, const CPubKey& vchPubKey)
+{
+    if (!vchPubKey.IsXMSS()) {
+        CKey key;
+        return DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, key);
+    }
+
+    CKeyingMaterial vchSecret;
+    if (!DecryptSecret(vMasterKey, vchCryptedSecret, vchPubKey.GetHash(), vchSecret))
+        return false;
+    return VerifyXMSSSecret(vchSecret, vchPubKey);
+}
+
 bool CCryptoKeyStore::SetCrypted()
 {
     LOCK(cs_KeyStore);
     if (fUseCrypto)
         return true;
-    if (!mapKeys.empty())
+    if (!mapKeys.empty() || !mapCompactKeys.empty() || !mapLazyKeys.empty())
         return false;
     fUseCrypto = true;
     return true;
@@ -185,6 +200,7 @@ bool CCryptoKeyStore::Lock()
     {
         LOCK(cs_KeyStore);
         vMasterKey.clear();
+        ClearXMSSKeyCache();
     }
 
     NotifyStatusChanged(this);
@@ -205,8 +221,7 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
         {
             const CPubKey &vchPubKey = (*mi).second.first;
             const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
-            CKey key;
-            if (!DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key))
+            if (!CheckCryptedKey(vMasterKeyIn, vchCryptedSecret, vchPubKey))
             {
                 keyFail = true;
                 break;
@@ -241,7 +256,7 @@ bool CCryptoKeyStore::AddKeyPubKey(const CKey& key, const CPubKey &pubkey)
     }
 
     std::vector<unsigned char> vchCryptedSecret;
-    CKeyingMaterial vchSecret(key.begin(), key.end());
+    CKeyingMaterial vchSecret = key.IsXMSS() ? key.raw_short_key() : CKeyingMaterial(key.begin(), key.end());
     if (!EncryptSecret(vMasterKey, vchSecret, pubkey.GetHash(), vchCryptedSecret)) {
         return false;
     }
@@ -249,6 +264,8 @@ bool CCryptoKeyStore::AddKeyPubKey(const CKey& key, const CPubKey &pubkey)
     if (!AddCryptedKey(pubkey, vchCryptedSecret)) {
         return false;
     }
+    if (key.IsXMSS())
+        CacheXMSSKey(pubkey.GetID(), key);
     return true;
 }
 
@@ -276,20 +293,31 @@ bool CCryptoKeyStore::HaveKey(const CKeyID &address) const
 
 bool CCryptoKeyStore::GetKey(const CKeyID &address, CKey& keyOut) const
 {
-    LOCK(cs_KeyStore);
-    if (!IsCrypted()) {
-        return CBasicKeyStore::GetKey(address, keyOut);
-    }
-
-    CryptedKeyMap::const_iterator mi = mapCryptedKeys.find(address);
-    if (mi != mapCryptedKeys.end())
+    CKeyingMaterial vchSecret;
     {
+        LOCK(cs_KeyStore);
+        if (!IsCrypted()) {
+            return CBasicKeyStore::GetKey(address, keyOut);
+        }
+
+        CryptedKeyMap::const_iterator mi = mapCryptedKeys.find(address);
+        if (mi == mapCryptedKeys.end())
+            return false;
         const CPubKey &vchPubKey = (*mi).second.first;
         const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
 		keyOut.AssignKeyStore(const_cast<CCryptoKeyStore*>(this));
-        return DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, keyOut);
+        if (vMasterKey.empty())
+            return false;
+        if (!vchPubKey.IsXMSS())
+            return DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, keyOut);
+        if (std::shared_ptr<const CKey> pkey = GetCachedXMSSKey(address)) {
+            keyOut = *pkey;
+            return true;
+        }
+        if (!DecryptSecret(vMasterKey, vchCryptedSecret, vchPubKey.GetHash(), vchSecret) || !VerifyXMSSSecret(vchSecret, vchPubKey))
+            return false;
     }
-    return false;
+    return ExpandXMSSKey(address, vchSecret, keyOut);
 }
 
 bool CCryptoKeyStore::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const
@@ -324,7 +352,7 @@ std::set<CKeyID> CCryptoKeyStore::GetKeys() const
 bool CCryptoKeyStore::EncryptKeys(CKeyingMaterial& vMasterKeyIn)
 {
     LOCK(cs_KeyStore);
-    if (!mapCryptedKeys.empty() || IsCrypted())
+    if (!mapCryptedKeys.empty() || IsCrypted() || !mapLazyKeys.empty())
         return false;
 
     fUseCrypto = true;
@@ -339,6 +367,16 @@ bool CCryptoKeyStore::EncryptKeys(CKeyingMaterial& vMasterKeyIn)
         if (!AddCryptedKey(vchPubKey, vchCryptedSecret))
             return false;
     }
+    for (CompactKeyMap::value_type& mKey : mapCompactKeys)
+    {
+        const CPubKey &vchPubKey = mKey.second.first;
+        std::vector<unsigned char> vchCryptedSecret;
+        if (!EncryptSecret(vMasterKeyIn, mKey.second.second, vchPubKey.GetHash(), vchCryptedSecret))
+            return false;
+        if (!AddCryptedKey(vchPubKey, vchCryptedSecret))
+            return false;
+    }
     mapKeys.clear();
+    mapCompactKeys.clear();
     return true;
 }
@@ -20,6 +20,12 @@ std::string GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-changetype", "What type of change to use (\"legacy\", \"p2sh-segwit\", or \"bech32\"). Default is same as -addresstype, except when -addresstype=p2sh-segwit a native segwit output is used when sending to a native segwit address)");
     strUsage += HelpMessageOpt("-disablewallet", _("Do not load the wallet and disable wallet RPC calls"));
     strUsage += HelpMessageOpt("-keypool=<n>", strprintf(_("Set key pool size to <n> (default: %u)"), DEFAULT_KEYPOOL_SIZE));
+    strUsage += HelpMessageOpt("-xmsskeycache=<n>", strprintf(_("Keep up to <n> MiB of expanded XMSS keys in memory (default: %u)"), DEFAULT_XMSS_KEY_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-xmsscompactkeys", strprintf(_("Store unencrypted XMSS keys without their hash tree, which is then rebuilt when a key is used (default: %u)"), DEFAULT_XMSS_COMPACT_KEYS));
+    strUsage += HelpMessageOpt("-xmsskeypool=<n>", strprintf(_("Number of XMSS keys of each key type in use to pregenerate in the background, 0 to disable (default: %u)"), DEFAULT_XMSS_KEYPOOL_SIZE));
+    strUsage += HelpMessageOpt("-xmsskeypoolthreads=<n>", strprintf(_("Number of threads building XMSS keys for the XMSS keypool (0 = one less than the number of cores, up to %d, default: %d)"), MAX_XMSS_KEYPOOL_THREADS, DEFAULT_XMSS_KEYPOOL_THREADS));
+    strUsage += HelpMessageOpt("-xmsssignthreads=<n>", strprintf(_("Number of threads making the XMSS signatures of a transaction (0 = one per core, default: %d)"), DEFAULT_XMSS_SIGN_THREADS));
+    strUsage += HelpMessageOpt("-xmssleafreserve=<n>", strprintf(_("Number of XMSS signatures to reserve per key with one wallet write (default: %u)"), DEFAULT_XMSS_LEAF_RESERVE));
     strUsage += HelpMessageOpt("-fallbackfee=<amt>", strprintf(_("A fee rate (in %s/kB) that will be used when fee estimation has insufficient data (default: %s)"),
                                                                CURRENCY_UNIT, FormatMoney(DEFAULT_FALLBACK_FEE)));
     strUsage += HelpMessageOpt("-discardfee=<amt>", strprintf(_("The fee rate (in %s/kB) that indicates your tolerance for discarding change by adding it to the fee (default: %s). "
@@ -30,6 +36,7 @@ std::string GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"),
                                                             CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions on startup"));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(_("Number of threads matching blocks against the wallet during a rescan (0 = one per core, default: %d)"), DEFAULT_RESCAN_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet on startup"));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), DEFAULT_SPEND_ZEROCONF_CHANGE));
     strUsage += HelpMessageOpt("-txconfirmtarget=<n>", strprintf(_("If paytxfee is not set, include enough fee so transactions begin confirmation on average within n blocks (default: %u)"), DEFAULT_TX_CONFIRM_TARGET));
@@ -304,6 +311,7 @@ void FlushWallets() {
 
 void StopWallets() {
     for (CWalletRef pwallet : vpwallets) {
+        pwallet->StopXMSSKeyPool();
         pwallet->Flush(true);
     }
 }
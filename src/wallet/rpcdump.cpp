@@ -397,7 +397,7 @@ UniValue importprunedfunds(const JSONRPCRequest& request)
     std::vector<uint256> vMatch;
     std::vector<unsigned int> vIndex;
     unsigned int txnIndex = 0;
-    if (merkleBlock.txn.ExtractMatches(vMatch, vIndex) == merkleBlock.header.hashMerkleRoot) {
+    if (merkleBlock.txn.ExtractMatches(vMatch, vIndex) == merkleBlock.header.GetHashMerkleRoot()) {
 
         LOCK(cs_main);
 
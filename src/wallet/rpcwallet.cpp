@@ -2781,6 +2781,75 @@ UniValue listlockunspent(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue listxmsskeys(const JSONRPCRequest& request)
+{
+    CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp)) {
+        return NullUniValue;
+    }
+
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "listxmsskeys ( maxleft )\n"
+            "\nReturns the XMSS keys of the wallet, the keys with the fewest signatures left first.\n"
+            "Every unspent output to a key takes one more signature to spend, so it is counted against the key.\n"
+            "\nArguments:\n"
+            "1. maxleft    (numeric, optional) Only list keys with at most this many signatures left\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\" : \"address\",   (string) The address of the key\n"
+            "    \"keytype\" : \"type\",      (string) The XMSS parameter set of the key\n"
+            "    \"usecount\" : n,          (numeric) The number of signatures made with the key\n"
+            "    \"maxusecount\" : n,       (numeric) The number of signatures the key can make\n"
+            "    \"txocount\" : n,          (numeric) The number of unspent outputs to the key\n"
+            "    \"left\" : n               (numeric) The number of signatures left after spending those outputs\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("listxmsskeys", "")
+            + HelpExampleCli("listxmsskeys", "10")
+            + HelpExampleRpc("listxmsskeys", "10")
+        );
+
+    ObserveSafeMode();
+
+    bool fMaxLeft = !request.params[0].isNull();
+    int64_t nMaxLeft = fMaxLeft ? request.params[0].get_int64() : 0;
+
+    LOCK2(cs_main, pwallet->cs_wallet);
+
+    std::vector<std::pair<size_t, CPubKey>> vKeys;
+    for (const CKeyID& keyid : pwallet->GetKeys()) {
+        CPubKey pubkey;
+        if (!pwallet->GetPubKey(keyid, pubkey) || !pubkey.IsXMSS())
+            continue;
+        size_t nLeft = pwallet->GetLeftKeyUses(keyid);
+        if (fMaxLeft && (int64_t)nLeft > nMaxLeft)
+            continue;
+        vKeys.emplace_back(nLeft, pubkey);
+    }
+    std::stable_sort(vKeys.begin(), vKeys.end(), [](const std::pair<size_t, CPubKey>& a, const std::pair<size_t, CPubKey>& b) {
+        return a.first < b.first;
+    });
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& entry : vKeys) {
+        const CPubKey& pubkey = entry.second;
+        UniValue o(UniValue::VOBJ);
+        o.push_back(Pair("address", EncodeDestination(GetDestinationForKey(pubkey, OUTPUT_TYPE_DEFAULT))));
+        o.push_back(Pair("keytype", KeyTypeToString(pubkey.GetKeyType())));
+        o.push_back(Pair("usecount", (uint64_t)pwallet->GetKeyUseCount(pubkey.GetID())));
+        o.push_back(Pair("maxusecount", (uint64_t)pubkey.GetMaxUseCount()));
+        o.push_back(Pair("txocount", (uint64_t)pwallet->GetKeyTxoCount(pubkey.GetID())));
+        o.push_back(Pair("left", (uint64_t)entry.first));
+        ret.push_back(o);
+    }
+
+    return ret;
+}
+
 UniValue settxfee(const JSONRPCRequest& request)
 {
     CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
@@ -3661,6 +3730,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "listtransactions",         &listtransactions,         {"account","count","skip","include_watchonly"} },
     { "wallet",             "listunspent",              &listunspent,              {"minconf","maxconf","addresses","include_unsafe","query_options"} },
     { "wallet",             "listwallets",              &listwallets,              {} },
+    { "wallet",             "listxmsskeys",             &listxmsskeys,             {"maxleft"} },
     { "wallet",             "lockunspent",              &lockunspent,              {"unlock","transactions"} },
     { "wallet",             "move",                     &movecmd,                  {"fromaccount","toaccount","amount","minconf","comment"} },
     { "wallet",             "sendfrom",                 &sendfrom,                 {"fromaccount","toaddress","amount","minconf","comment","comment_to"} },
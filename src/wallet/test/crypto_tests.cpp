@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <random.h>
 #include <test/test_bitcoin.h>
 #include <utilstrencodings.h>
 #include <wallet/crypter.h>
@@ -123,4 +124,53 @@ BOOST_AUTO_TEST_CASE(decrypt) {
     }
 }
 
+class TestCryptoKeyStore : public CCryptoKeyStore
+{
+public:
+    using CCryptoKeyStore::EncryptKeys;
+    using CCryptoKeyStore::Unlock;
+};
+
+BOOST_AUTO_TEST_CASE(xmss_key_cache) {
+    CKey key;
+    key.MakeNewKey(CKeyType::XMSS_256_H10);
+    CPubKey pubkey = key.GetPubKey();
+
+    CKeyingMaterial vMasterKey(WALLET_CRYPTO_KEY_SIZE);
+    GetStrongRandBytes(vMasterKey.data(), WALLET_CRYPTO_KEY_SIZE);
+
+    TestCryptoKeyStore keystore;
+    keystore.SetXMSSKeyCacheSize(key.size() + 1);
+    BOOST_CHECK(keystore.AddKeyPubKey(key, pubkey));
+    BOOST_CHECK(keystore.EncryptKeys(vMasterKey));
+    BOOST_CHECK(keystore.Unlock(vMasterKey));
+
+    // the first call decrypts and caches the key, the second one is served from the cache
+    for (int i = 0; i < 2; i++) {
+        CKey keyOut;
+        BOOST_CHECK(keystore.GetKey(pubkey.GetID(), keyOut));
+        BOOST_CHECK(keyOut == key);
+        BOOST_CHECK(keyOut.VerifyPubKey(pubkey));
+    }
+
+    // signers get the cached key itself, not a copy
+    std::shared_ptr<const CKey> pkey = keystore.GetKeyHandle(pubkey.GetID());
+    BOOST_CHECK(pkey && *pkey == key);
+    BOOST_CHECK(keystore.GetKeyHandle(pubkey.GetID()) == pkey);
+    pkey.reset();
+
+    // locking wipes the cache
+    BOOST_CHECK(keystore.Lock());
+    BOOST_CHECK(!keystore.GetKeyHandle(pubkey.GetID()));
+    CKey keyLocked;
+    BOOST_CHECK(!keystore.GetKey(pubkey.GetID(), keyLocked));
+
+    // a cache too small for the key still decrypts it
+    keystore.SetXMSSKeyCacheSize(key.size() - 1);
+    BOOST_CHECK(keystore.Unlock(vMasterKey));
+    CKey keyOut;
+    BOOST_CHECK(keystore.GetKey(pubkey.GetID(), keyOut));
+    BOOST_CHECK(keyOut == key);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
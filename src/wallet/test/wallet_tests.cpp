@@ -535,6 +535,91 @@ BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_immature_credit, TestChain100Setup)
     BOOST_CHECK_EQUAL(wtx.GetImmatureCredit(), 50*COIN);
 }
 
+//! The pubkey DeriveNewChildKey() gives the n-th external key of an HD chain
+static CPubKey DeriveExternalKey(const CKey& seed, uint32_t n)
+{
+    const uint32_t nHardened = 0x80000000;
+    CExtKey masterKey, accountKey, chainChildKey, childKey;
+    masterKey.SetMaster(seed.begin(), seed.size());
+    masterKey.Derive(accountKey, nHardened);
+    accountKey.Derive(chainChildKey, nHardened);
+    chainChildKey.Derive(childKey, n | nHardened);
+    return childKey.key.GetPubKey();
+}
+
+// Verify the rescan matches a block again when a keypool top-up from an
+// earlier block adds the key it pays to.
+BOOST_FIXTURE_TEST_CASE(rescan_keypool_topup, TestChain100Setup)
+{
+    CBlockIndex* const nullBlock = nullptr;
+
+    // the two blocks pay to the first two external keys of an HD chain
+    CKey seed;
+    seed.MakeNewKey(CKeyType::ECDSA_COMPRESSED);
+    CBlockIndex* oldTip = chainActive.Tip();
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(DeriveExternalKey(seed, 0)));
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(DeriveExternalKey(seed, 1)));
+
+    ::bitdb.MakeMock();
+    gArgs.ForceSetArg("-keypool", "1");
+    {
+        CWallet wallet(std::unique_ptr<CWalletDBWrapper>(new CWalletDBWrapper(&bitdb, "wallet_test_rescantopup.dat")));
+        bool fFirstRun;
+        BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DB_LOAD_OK);
+        AddKey(wallet, seed);
+        BOOST_CHECK(wallet.SetHDMasterKey(seed.GetPubKey()));
+        BOOST_CHECK(wallet.TopUpKeyPool());
+        BOOST_CHECK(wallet.HaveKey(DeriveExternalKey(seed, 0).GetID()));
+        BOOST_CHECK(!wallet.HaveKey(DeriveExternalKey(seed, 1).GetID()));
+
+        // the second block is matched ahead of the top-up the first one causes
+        {
+            WalletRescanReserver reserver(&wallet);
+            reserver.reserve();
+            BOOST_CHECK_EQUAL(nullBlock, wallet.ScanForWalletTransactions(oldTip, nullptr, reserver));
+        }
+        BOOST_CHECK(wallet.HaveKey(DeriveExternalKey(seed, 1).GetID()));
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(wallet.mapWallet.size(), 2U);
+    }
+    gArgs.ForceSetArg("-keypool", std::to_string(DEFAULT_KEYPOOL_SIZE));
+    ::bitdb.Flush(true);
+    ::bitdb.Reset();
+}
+
+// Verify an aborted rescan stops with blocks still in the pipeline, and the
+// next one starts over.
+BOOST_FIXTURE_TEST_CASE(rescan_abort, TestChain100Setup)
+{
+    CBlockIndex* const nullBlock = nullptr;
+    CWallet wallet;
+    AddKey(wallet, coinbaseKey);
+
+    // abort once the first block is added
+    boost::signals2::scoped_connection conn = wallet.NotifyTransactionChanged.connect(
+        [](CWallet* pwallet, const uint256& hashTx, ChangeType status) { pwallet->AbortRescan(); });
+    {
+        WalletRescanReserver reserver(&wallet);
+        reserver.reserve();
+        BOOST_CHECK_EQUAL(nullBlock, wallet.ScanForWalletTransactions(chainActive.Genesis(), nullptr, reserver));
+    }
+    BOOST_CHECK(wallet.IsAbortingRescan());
+    {
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(wallet.mapWallet.size(), 1U);
+    }
+
+    conn.disconnect();
+    {
+        WalletRescanReserver reserver(&wallet);
+        reserver.reserve();
+        BOOST_CHECK_EQUAL(nullBlock, wallet.ScanForWalletTransactions(chainActive.Genesis(), nullptr, reserver));
+    }
+    BOOST_CHECK(!wallet.IsAbortingRescan());
+    LOCK2(cs_main, wallet.cs_wallet);
+    BOOST_CHECK_EQUAL(wallet.mapWallet.size(), (size_t)chainActive.Height());
+}
+
 static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64_t blockTime)
 {
     CMutableTransaction tx;
@@ -861,5 +946,199 @@ BOOST_AUTO_TEST_CASE(create_and_reload)
 	}
 }		
 
+BOOST_AUTO_TEST_CASE(xmss_keypool)
+{
+	std::string walletFile("wallet_test_xmsspool.dat");
+	bool fFirstRun = false;
+
+	MockDB mockdb;
+
+	std::unique_ptr<CWalletDBWrapper> dbw(new CWalletDBWrapper(&bitdb, walletFile));
+	CWallet wallet(std::move(dbw));
+	BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DB_LOAD_OK);
+
+	gArgs.ForceSetArg("-xmsskeypool", "2");
+
+	// the first key of a type is generated in place, after that the type is pregenerated
+	CPubKey pubkey1;
+	BOOST_CHECK(wallet.GetNewKey(pubkey1, CKeyType::XMSS_256_H10, false));
+	BOOST_CHECK_EQUAL(wallet.GetXMSSKeyPoolSize(CKeyType::XMSS_256_H10), 0U);
+
+	wallet.StartXMSSKeyPool();
+	BOOST_CHECK(wallet.WaitForXMSSKeyPoolSize(CKeyType::XMSS_256_H10, 2, 60 * 1000));
+	BOOST_CHECK_EQUAL(wallet.GetXMSSKeyPoolSize(CKeyType::XMSS_256_H10), 2U);
+
+	CPubKey pubkey2;
+	BOOST_CHECK(wallet.GetNewKey(pubkey2, CKeyType::XMSS_256_H10, false));
+	BOOST_CHECK(pubkey2 != pubkey1);
+	BOOST_CHECK(pubkey2.GetKeyType() == CKeyType::XMSS_256_H10);
+	BOOST_CHECK(wallet.HaveKey(pubkey2.GetID()));
+	BOOST_CHECK(wallet.GetLeftKeyUses(pubkey2.GetID()) > 0);
+
+	wallet.StopXMSSKeyPool();
+	gArgs.ForceSetArg("-xmsskeypool", std::to_string(DEFAULT_XMSS_KEYPOOL_SIZE));
+	wallet.Flush(true);
+}
+
+BOOST_AUTO_TEST_CASE(xmss_leaf_reserve)
+{
+	std::string walletFile("wallet_test_leafreserve.dat");
+	bool fFirstRun = false;
+
+	MockDB mockdb;
+
+	std::unique_ptr<CWalletDBWrapper> dbw(new CWalletDBWrapper(&bitdb, walletFile));
+	CWallet wallet(std::move(dbw));
+	BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DB_LOAD_OK);
+
+	gArgs.ForceSetArg("-xmssleafreserve", "4");
+
+	CPubKey pubkey;
+	BOOST_CHECK(wallet.GetNewKey(pubkey, CKeyType::XMSS_256_H10, false));
+	CKeyID keyid = pubkey.GetID();
+
+	// indices are handed out one by one, the database only sees the reserved limit
+	uint64_t nReserved = 0;
+	for (uint64_t i = 0; i < 6; i++)
+	{
+		BOOST_CHECK_EQUAL(wallet.GetKeyUseCountInc(keyid), i);
+		BOOST_CHECK(CWalletDB(wallet.GetDBHandle()).ReadKeyUseCount(pubkey, nReserved));
+		BOOST_CHECK_EQUAL(nReserved, i < 4 ? 4U : 8U);
+	}
+	BOOST_CHECK_EQUAL(wallet.GetKeyUseCount(keyid), 6U);
+
+	// a use count seen on the chain beyond the reservation is written through
+	BOOST_CHECK(wallet.SetKeyUseCount(keyid, 10));
+	BOOST_CHECK(CWalletDB(wallet.GetDBHandle()).ReadKeyUseCount(pubkey, nReserved));
+	BOOST_CHECK_EQUAL(nReserved, 10U);
+
+	// after a restart the whole reserved range is skipped
+	{
+		LOCK(wallet.cs_wallet);
+		BOOST_CHECK(wallet.LoadKeyUseCount(keyid, nReserved));
+	}
+	BOOST_CHECK_EQUAL(wallet.GetKeyUseCountInc(keyid), 10U);
+
+	gArgs.ForceSetArg("-xmssleafreserve", std::to_string(DEFAULT_XMSS_LEAF_RESERVE));
+	wallet.Flush(true);
+}
+
+BOOST_AUTO_TEST_CASE(xmss_lazy_key_record)
+{
+	std::string walletFile("wallet_test_lazykey.dat");
+	bool fFirstRun = false;
+
+	MockDB mockdb;
+
+	std::unique_ptr<CWalletDBWrapper> dbw(new CWalletDBWrapper(&bitdb, walletFile));
+	CWallet wallet(std::move(dbw));
+	BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DB_LOAD_OK);
+
+	CPubKey pubkey;
+	BOOST_CHECK(wallet.GetNewKey(pubkey, CKeyType::XMSS_256_H10, false));
+	CKey key;
+	BOOST_CHECK(wallet.GetKey(pubkey.GetID(), key));
+
+	// new keys are stored with their hash tree, which is read back as it is
+	CKeyingMaterial vchLong = key.raw_private_key();
+	CKeyingMaterial vchSecret;
+	BOOST_CHECK(wallet.ReadLazyKey(pubkey, vchSecret));
+	BOOST_CHECK(vchSecret == vchLong);
+
+	// with -xmsscompactkeys a record in long form is rewritten compact on first use
+	wallet.SetCompactXMSSKeys(true);
+	BOOST_CHECK(wallet.ReadLazyKey(pubkey, vchSecret));
+	BOOST_CHECK(vchSecret == key.raw_short_key());
+	CPrivKey vchPrivKey;
+	BOOST_CHECK(CWalletDB(wallet.GetDBHandle()).ReadKey(pubkey, vchPrivKey));
+	BOOST_CHECK(CKeyingMaterial(vchPrivKey.begin(), vchPrivKey.end()) == key.raw_short_key());
+
+	wallet.Flush(true);
+}
+
+BOOST_AUTO_TEST_CASE(xmss_key_txo_index)
+{
+	std::string walletFile("wallet_test_keytxos.dat");
+	bool fFirstRun = false;
+
+	MockDB mockdb;
+
+	std::unique_ptr<CWalletDBWrapper> dbw(new CWalletDBWrapper(&bitdb, walletFile));
+	CWallet wallet(std::move(dbw));
+	BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DB_LOAD_OK);
+
+	CPubKey pubkey;
+	BOOST_CHECK(wallet.GetNewKey(pubkey, CKeyType::XMSS_256_H10, false));
+	CKeyID keyid = pubkey.GetID();
+	wallet.LearnRelatedScripts(pubkey, OUTPUT_TYPE_DEFAULT);
+	CScript scriptPubKey = GetScriptForDestination(GetDestinationForKey(pubkey, OUTPUT_TYPE_DEFAULT));
+
+	CMutableTransaction txFund;
+	txFund.vin.resize(1);
+	txFund.vin[0].prevout = COutPoint(GetRandHash(), 0);
+	txFund.vout.resize(2);
+	txFund.vout[0] = CTxOut(1 * COIN, scriptPubKey);
+	txFund.vout[1] = CTxOut(2 * COIN, scriptPubKey);
+	CWalletTx wtxFund(&wallet, MakeTransactionRef(txFund));
+	BOOST_CHECK(wallet.AddToWallet(wtxFund));
+
+	// every unspent output takes a leaf of the key to be spent
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(keyid), 2U);
+	BOOST_CHECK_EQUAL(wallet.GetLeftKeyUses(keyid), pubkey.GetMaxUseCount() - 2);
+
+	CMutableTransaction txSpend;
+	txSpend.vin.resize(1);
+	txSpend.vin[0].prevout = COutPoint(txFund.GetHash(), 0);
+	txSpend.vout.resize(1);
+	txSpend.vout[0] = CTxOut(1 * COIN, CScript() << OP_TRUE);
+	CWalletTx wtxSpend(&wallet, MakeTransactionRef(txSpend));
+	BOOST_CHECK(wallet.AddToWallet(wtxSpend));
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(keyid), 1U);
+
+	// abandoning the spend makes its input spendable again
+	BOOST_CHECK(wallet.AbandonTransaction(txSpend.GetHash()));
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(keyid), 2U);
+
+	// outputs of an abandoned transaction are not counted
+	CMutableTransaction txFund2;
+	txFund2.vin.resize(1);
+	txFund2.vin[0].prevout = COutPoint(GetRandHash(), 0);
+	txFund2.vout.resize(1);
+	txFund2.vout[0] = CTxOut(1 * COIN, scriptPubKey);
+	CWalletTx wtxFund2(&wallet, MakeTransactionRef(txFund2));
+	BOOST_CHECK(wallet.AddToWallet(wtxFund2));
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(keyid), 3U);
+	BOOST_CHECK(wallet.AbandonTransaction(txFund2.GetHash()));
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(keyid), 2U);
+
+	// a spend conflicted by a block gives its input back and its outputs are dropped
+	CPubKey pubkey2;
+	BOOST_CHECK(wallet.GetNewKey(pubkey2, CKeyType::XMSS_256_H10, false));
+	wallet.LearnRelatedScripts(pubkey2, OUTPUT_TYPE_DEFAULT);
+	CMutableTransaction txSpend2;
+	txSpend2.vin.resize(2);
+	txSpend2.vin[0].prevout = COutPoint(txFund.GetHash(), 1);
+	txSpend2.vin[1].prevout = COutPoint(GetRandHash(), 0);
+	txSpend2.vout.resize(1);
+	txSpend2.vout[0] = CTxOut(1 * COIN, GetScriptForDestination(GetDestinationForKey(pubkey2, OUTPUT_TYPE_DEFAULT)));
+	CWalletTx wtxSpend2(&wallet, MakeTransactionRef(txSpend2));
+	BOOST_CHECK(wallet.AddToWallet(wtxSpend2));
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(keyid), 1U);
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(pubkey2.GetID()), 1U);
+
+	CMutableTransaction txConflict;
+	txConflict.vin.resize(1);
+	txConflict.vin[0].prevout = txSpend2.vin[1].prevout;
+	txConflict.vout.resize(1);
+	txConflict.vout[0] = CTxOut(1 * COIN, CScript() << OP_TRUE);
+	CBlock block;
+	block.vtx.push_back(MakeTransactionRef(txConflict));
+	wallet.BlockConnected(std::make_shared<const CBlock>(block), chainActive.Tip(), {});
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(keyid), 2U);
+	BOOST_CHECK_EQUAL(wallet.GetKeyTxoCount(pubkey2.GetID()), 0U);
+
+	wallet.Flush(true);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
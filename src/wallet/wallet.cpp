@@ -32,6 +32,8 @@
 #include <wallet/fees.h>
 
 #include <assert.h>
+#include <chrono>
+#include <deque>
 #include <future>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -291,6 +293,14 @@ bool CWallet::AddKeyPubKeyWithDB(CWalletDB &walletdb, const CKey& secret, const
     }
 
     if (!IsCrypted()) {
+        if (secret.IsXMSS() && !fCompactXMSSKeys) {
+            // the record keeps the hash tree, read it from there when the key
+            // drops out of the expanded key cache
+            bpqcrypto::secure_vector<uint8_t> vchLong = secret.raw_private_key();
+            return walletdb.WriteKey(pubkey, CPrivKey(vchLong.begin(), vchLong.end()), mapKeyMetadata[pubkey.GetID()]) &&
+                walletdb.WriteKeyUseCount(pubkey, GetKeyUseCount(pubkey.GetID())) &&
+                LoadLazyKey(pubkey);
+        }
         return	walletdb.WriteKey(pubkey,
 					secret.GetPrivKey(),
 					mapKeyMetadata[pubkey.GetID()]) && 
@@ -342,7 +352,10 @@ bool CWallet::LoadKeyMetadata(const CKeyID& keyID, const CKeyMetadata &meta)
 bool CWallet::LoadKeyUseCount(const CKeyID& keyID, uint64_t use_count)
 {
 	AssertLockHeld(cs_wallet); // mapKeyUseCount
+	LOCK(cs_KeyStore);
+	// the stored value is the reserved limit, indices below it may have been used
 	mapKeyUseCount[keyID] = use_count;
+	mapKeyUseReserved[keyID] = use_count;
 	return true;
 }
 
@@ -448,8 +461,10 @@ bool CWallet::Unlock(const SecureString& strWalletPassphrase)
                 return false;
             if (!crypter.Decrypt(pMasterKey.second.vchCryptedKey, _vMasterKey))
                 continue; // try another master key
-            if (CCryptoKeyStore::Unlock(_vMasterKey))
+            if (CCryptoKeyStore::Unlock(_vMasterKey)) {
+                NotifyXMSSKeyPool();
                 return true;
+            }
         }
     }
     return false;
@@ -682,6 +697,82 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::UpdateKeyTxo(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_wallet); // mapWallet, mapKeyTxos
+
+    auto it = mapKeyTxos.find(outpoint);
+    if (it != mapKeyTxos.end()) {
+        auto itCount = mapKeyTxoCount.find(it->second);
+        if (--itCount->second == 0)
+            mapKeyTxoCount.erase(itCount);
+        mapKeyTxos.erase(it);
+    }
+
+    auto itTx = mapWallet.find(outpoint.hash);
+    if (itTx == mapWallet.end() || outpoint.n >= itTx->second.tx->vout.size())
+        return;
+
+    // outputs of abandoned or conflicted transactions will not be spent,
+    // spenders count by the same rule as for the balance
+    const CWalletTx& wtx = itTx->second;
+    if (wtx.isAbandoned() || wtx.GetDepthInMainChain() < 0 || IsSpent(outpoint.hash, outpoint.n))
+        return;
+
+    CTxDestination dest;
+    CPubKey pubkey;
+    if (!ExtractDestination(itTx->second.tx->vout[outpoint.n].scriptPubKey, dest) || !GetPubKey(dest, pubkey) || !pubkey.IsXMSS())
+        return;
+
+    mapKeyTxos.emplace(outpoint, pubkey.GetID());
+    mapKeyTxoCount[pubkey.GetID()]++;
+}
+
+void CWallet::UpdateKeyTxos(const CWalletTx& wtx)
+{
+    if (!wtx.IsCoinBase()) {
+        for (const CTxIn& txin : wtx.tx->vin)
+            UpdateKeyTxo(txin.prevout);
+    }
+
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++)
+        UpdateKeyTxo(COutPoint(hash, i));
+}
+
+void CWallet::RebuildKeyTxoIndex()
+{
+    AssertLockHeld(cs_wallet); // mapWallet, mapKeyTxos
+
+    mapKeyTxos.clear();
+    mapKeyTxoCount.clear();
+    for (const auto& entry : mapWallet) {
+        for (unsigned int i = 0; i < entry.second.tx->vout.size(); i++)
+            UpdateKeyTxo(COutPoint(entry.first, i));
+    }
+}
+
+bool CWallet::ReadLazyKey(const CPubKey &pubkey, CKeyingMaterial& vchSecret) const
+{
+    CPrivKey vchPrivKey;
+    CWalletDB walletdb(*dbw);
+    if (!walletdb.ReadKey(pubkey, vchPrivKey))
+        return false;
+    vchSecret.assign(vchPrivKey.begin(), vchPrivKey.end());
+    if (!fCompactXMSSKeys)
+        return true;
+    vchSecret = GetCompactXMSSSecret(vchSecret);
+    if (vchSecret.empty())
+        return false;
+
+    // keys stored with their hash tree are rewritten in compact form on first use
+    if (vchSecret.size() != vchPrivKey.size()) {
+        if (walletdb.RewriteKey(pubkey, CPrivKey(vchSecret.begin(), vchSecret.end())))
+            LogPrintf("%s: rewrote XMSS key %s in compact form\n", __func__, pubkey.GetID().ToString());
+    }
+    return true;
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -718,6 +809,9 @@ bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 
     {
         LOCK(cs_wallet);
+        // lazily loaded keys have to be read before the encryption transaction starts
+        if (!FetchLazyKeys())
+            return false;
         mapMasterKeys[++nMasterKeyMaxID] = kMasterKey;
         assert(!pwalletdbEncryption);
         pwalletdbEncryption = new CWalletDB(*dbw);
@@ -1039,6 +1133,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
 	UpdateUseCount(wtx, walletdb);
+
+    if (fInsertedNew || fUpdated)
+        UpdateKeyTxos(wtx);
 	
     // Write to disk
     if (fInsertedNew || fUpdated)
@@ -1099,7 +1196,7 @@ bool CWallet::LoadToWallet(const CWalletTx& wtxIn)
  * Abandoned state should probably be more carefully tracked via different
  * posInBlock signals or by checking mempool presence when necessary.
  */
-bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate)
+bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate, bool fCheckIsMine)
 {
     const CTransaction& tx = *ptx;
     {
@@ -1120,7 +1217,7 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockI
 
         bool fExisted = mapWallet.count(tx.GetHash()) != 0;
         if (fExisted && !fUpdate) return false;
-        if (fExisted || IsMine(tx) || IsFromMe(tx))
+        if (fExisted || (fCheckIsMine && IsMine(tx)) || IsFromMe(tx))
         {
             /* Check if any keys in the wallet keypool that were supposed to be unused
              * have appeared in a new transaction. If so, remove those keys from the keypool.
@@ -1143,6 +1240,12 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockI
                             LogPrintf("%s: Topping up keypool failed (locked wallet)\n", __func__);
                         }
                     }
+                    if (m_xmss_pool_key_to_index.count(keyid)) {
+                        LogPrintf("%s: Detected a used XMSS keypool key, removing it from the keypool\n", __func__);
+                        CWalletDB walletdb(*dbw);
+                        RemoveXMSSKeyFromPool(walletdb, keyid);
+                        NotifyXMSSKeyPool();
+                    }
                 }
             }
 
@@ -1220,6 +1323,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
                     it->second.MarkDirty();
                 }
             }
+            UpdateKeyTxos(wtx);
         }
     }
 
@@ -1283,6 +1387,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
                     it->second.MarkDirty();
                 }
             }
+            UpdateKeyTxos(wtx);
         }
     }
 }
@@ -1302,6 +1407,10 @@ void CWallet::SyncTransaction(const CTransactionRef& ptx, const CBlockIndex *pin
             it->second.MarkDirty();
         }
     }
+    auto it = mapWallet.find(tx.GetHash());
+    if (it != mapWallet.end()) {
+        UpdateKeyTxos(it->second);
+    }
 }
 
 void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
@@ -1332,6 +1441,7 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
     // to abandon a transaction and then have it inadvertently cleared by
     // the notification that the conflicted transaction was evicted.
 
+    fBatchKeyUseCounts = true;
     for (const CTransactionRef& ptx : vtxConflicted) {
         SyncTransaction(ptx);
         TransactionRemovedFromMempool(ptx);
@@ -1340,6 +1450,7 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
         SyncTransaction(pblock->vtx[i], pindex, i);
         TransactionRemovedFromMempool(pblock->vtx[i]);
     }
+    WriteKeyUseCounts();
 
     m_last_block_processed = pindex;
 }
@@ -1770,6 +1881,161 @@ void CWallet::RescanMemPoolForNewKey(CPubKey const & pubkey)
     }
 }
 
+namespace {
+/** A block of a rescan on its way through RescanPipeline */
+struct RescanBlock
+{
+    CBlockIndex* pindex;
+    CDiskBlockPos pos;
+    bool fCheckSolution;
+    std::shared_ptr<const CBlock> block; //!< null if the block could not be read
+    std::vector<bool> vMine;             //!< whether each transaction pays to the wallet
+    int nKeyGeneration = 0;              //!< RescanPipeline::nKeyGeneration the outputs were matched with
+    bool fClaimed = false;
+    bool fMatched = false;
+};
+
+/**
+ * Reads the blocks of a rescan ahead on one thread and matches their outputs
+ * against the wallet keys on several others, so ScanForWalletTransactions()
+ * only has to add the transactions to the wallet in chain order. The caller
+ * may hold cs_main, so the blocks are looked up before they are handed over.
+ * The keys change when an added transaction tops up the keypool: the scan
+ * then bumps nKeyGeneration and checks blocks matched before that again.
+ */
+class RescanPipeline
+{
+public:
+    RescanPipeline(const CWallet& walletIn, std::vector<std::shared_ptr<RescanBlock>> vBlocksIn, unsigned int nThreads);
+    ~RescanPipeline();
+
+    /** Wait for the next block in chain order, false after the last one */
+    bool Next(std::shared_ptr<RescanBlock>& item);
+
+    std::atomic<int> nKeyGeneration{0};
+
+private:
+    void ThreadRead();
+    void ThreadMatch();
+
+    const CWallet& wallet;
+    const std::vector<std::shared_ptr<RescanBlock>> vBlocks;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::shared_ptr<RescanBlock>> queue;
+    bool fReadDone = false;
+    bool fStop = false;
+    std::vector<std::thread> threads;
+};
+
+RescanPipeline::RescanPipeline(const CWallet& walletIn, std::vector<std::shared_ptr<RescanBlock>> vBlocksIn, unsigned int nThreads)
+    : wallet(walletIn), vBlocks(std::move(vBlocksIn))
+{
+    threads.emplace_back(&RescanPipeline::ThreadRead, this);
+    for (unsigned int i = 0; i < nThreads; i++)
+        threads.emplace_back(&RescanPipeline::ThreadMatch, this);
+}
+
+RescanPipeline::~RescanPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStop = true;
+    }
+    cond.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+bool RescanPipeline::Next(std::shared_ptr<RescanBlock>& item)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this] { return queue.empty() ? fReadDone : queue.front()->fMatched; });
+    if (queue.empty())
+        return false;
+    item = queue.front();
+    queue.pop_front();
+    lock.unlock();
+    cond.notify_all();
+    return true;
+}
+
+void RescanPipeline::ThreadRead()
+{
+    RenameThread("bitcoin-rescanread");
+
+    for (const std::shared_ptr<RescanBlock>& item : vBlocks) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this] { return fStop || queue.size() < RESCAN_PREFETCH_BLOCKS; });
+            if (fStop)
+                break;
+        }
+
+        std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+        if (!ReadBlockFromDisk(*block, item->pos, Params().GetConsensus(), item->fCheckSolution)) {
+            item->fClaimed = item->fMatched = true;
+        } else if (block->GetHash() != item->pindex->GetBlockHash()) {
+            LogPrintf("%s: GetHash() doesn't match index for %s at %s\n", __func__, item->pindex->ToString(), item->pos.ToString());
+            item->fClaimed = item->fMatched = true;
+        } else {
+            item->block = block;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(item);
+        }
+        cond.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fReadDone = true;
+    }
+    cond.notify_all();
+}
+
+void RescanPipeline::ThreadMatch()
+{
+    RenameThread("bitcoin-rescanmatch");
+
+    while (true) {
+        std::shared_ptr<RescanBlock> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this, &item] {
+                if (fStop)
+                    return true;
+                for (const std::shared_ptr<RescanBlock>& queued : queue) {
+                    if (!queued->fClaimed) {
+                        item = queued;
+                        return true;
+                    }
+                }
+                return fReadDone;
+            });
+            if (!item)
+                return;
+            item->fClaimed = true;
+            item->nKeyGeneration = nKeyGeneration;
+        }
+
+        // only the key store is used here, cs_wallet is not needed
+        std::vector<bool> vMine(item->block->vtx.size());
+        for (size_t i = 0; i < vMine.size(); i++)
+            vMine[i] = wallet.IsMine(*item->block->vtx[i]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            item->vMine.swap(vMine);
+            item->fMatched = true;
+        }
+        cond.notify_all();
+    }
+}
+} // namespace
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -1785,6 +2051,9 @@ void CWallet::RescanMemPoolForNewKey(CPubKey const & pubkey)
  * Caller needs to make sure pindexStop (and the optional pindexStart) are on
  * the main chain after to the addition of any new keys you want to detect
  * transactions for.
+ *
+ * Blocks are read and matched against the wallet keys ahead of time on
+ * -rescanthreads threads, see RescanPipeline.
  */
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlockIndex* pindexStop, const WalletRescanReserver &reserver, bool fUpdate)
 {
@@ -1810,48 +2079,85 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
             dProgressTip = GuessVerificationProgress(chainParams.TxData(), tip);
         }
-        while (pindex && !fAbortRescan)
+        unsigned int nThreads = std::max(gArgs.GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS), (int64_t) 0);
+        if (nThreads == 0)
+            nThreads = std::max(1u, std::thread::hardware_concurrency());
+        bool fDone = false;
+        while (pindex && !fAbortRescan && !fDone)
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
-                double gvp = 0;
-                {
-                    LOCK(cs_main);
-                    gvp = GuessVerificationProgress(chainParams.TxData(), pindex);
-                }
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((gvp - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-            }
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
+            std::vector<std::shared_ptr<RescanBlock>> vBlocks;
+            {
                 LOCK(cs_main);
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+                for (CBlockIndex* pnext = pindex; pnext && vBlocks.size() < RESCAN_CHUNK_BLOCKS; pnext = chainActive.Next(pnext)) {
+                    std::shared_ptr<RescanBlock> item = std::make_shared<RescanBlock>();
+                    item->pindex = pnext;
+                    item->pos = pnext->GetBlockPos();
+                    item->fCheckSolution = fCheckBlockSolutions || !pnext->IsValid(BLOCK_VALID_TREE);
+                    vBlocks.push_back(item);
+                    if (pnext == pindexStop)
+                        break;
+                }
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                LOCK2(cs_main, cs_wallet);
-                if (pindex && !chainActive.Contains(pindex)) {
-                    // Abort scan if current block is no longer active, to prevent
-                    // marking transactions as coming from the wrong block.
+            RescanPipeline pipeline(*this, vBlocks, nThreads);
+            std::shared_ptr<RescanBlock> item;
+            while (!fAbortRescan && pipeline.Next(item))
+            {
+                pindex = item->pindex;
+                if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
+                    double gvp = 0;
+                    {
+                        LOCK(cs_main);
+                        gvp = GuessVerificationProgress(chainParams.TxData(), pindex);
+                    }
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((gvp - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+                }
+                if (GetTime() >= nNow + 60) {
+                    nNow = GetTime();
+                    LOCK(cs_main);
+                    LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+                }
+
+                if (item->block) {
+                    const CBlock& block = *item->block;
+                    LOCK2(cs_main, cs_wallet);
+                    if (pindex && !chainActive.Contains(pindex)) {
+                        // Abort scan if current block is no longer active, to prevent
+                        // marking transactions as coming from the wrong block.
+                        ret = pindex;
+                        fDone = true;
+                        break;
+                    }
+                    // keys from a keypool top-up are not known to blocks matched before it
+                    bool fStale = item->nKeyGeneration != pipeline.nKeyGeneration;
+                    int64_t nMaxKeypoolIndex = m_max_keypool_index;
+                    fBatchKeyUseCounts = true;
+                    for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                        AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate, fStale || item->vMine[posInBlock]);
+                    }
+                    WriteKeyUseCounts();
+                    if (m_max_keypool_index != nMaxKeypoolIndex)
+                        ++pipeline.nKeyGeneration;
+                } else {
                     ret = pindex;
+                }
+                if (pindex == pindexStop) {
+                    fDone = true;
                     break;
                 }
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                {
+                    LOCK(cs_main);
+                    if (tip != chainActive.Tip()) {
+                        tip = chainActive.Tip();
+                        // in case the tip has changed, update progress max
+                        dProgressTip = GuessVerificationProgress(chainParams.TxData(), tip);
+                    }
                 }
-            } else {
-                ret = pindex;
-            }
-            if (pindex == pindexStop) {
-                break;
             }
-            {
+            if (!fDone && !fAbortRescan) {
+                // continue after the chunk, up to the tip as it is now
                 LOCK(cs_main);
                 pindex = chainActive.Next(pindex);
-                if (tip != chainActive.Tip()) {
-                    tip = chainActive.Tip();
-                    // in case the tip has changed, update progress max
-                    dProgressTip = GuessVerificationProgress(chainParams.TxData(), tip);
-                }
             }
         }
         if (pindex && fAbortRescan) {
@@ -1859,6 +2165,11 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
         }
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
+    {
+        // outputs to keys imported before the rescan were already in the wallet
+        LOCK2(cs_main, cs_wallet);
+        RebuildKeyTxoIndex();
+    }
     return ret;
 }
 
@@ -2783,22 +3094,16 @@ bool CWallet::SignTransaction(CMutableTransaction &tx)
         return false;
     }
 
-    int nIn = 0;
+    std::vector<CTxOut> vSpent;
+    vSpent.reserve(tx.vin.size());
     for (const auto& input : tx.vin) {
         std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(input.prevout.hash);
         if(mi == mapWallet.end() || input.prevout.n >= mi->second.tx->vout.size()) {
             return false;
         }
-        const CScript& scriptPubKey = mi->second.tx->vout[input.prevout.n].scriptPubKey;
-        const CAmount& amount = mi->second.tx->vout[input.prevout.n].nValue;
-        SignatureData sigdata;
-        if (!ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, amount, SIGHASH_ALL), scriptPubKey, sigdata)) {
-            return false;
-        }
-        UpdateTransaction(tx, nIn, sigdata);
-        nIn++;
+        vSpent.push_back(mi->second.tx->vout[input.prevout.n]);
     }
-    return true;
+    return SignTransactionInputs(*this, tx, vSpent, SIGHASH_ALL, std::max(gArgs.GetArg("-xmsssignthreads", DEFAULT_XMSS_SIGN_THREADS), (int64_t) 0));
 }
 
 bool CWallet::FundTransaction(CMutableTransaction& tx, CAmount& nFeeRet, int& nChangePosInOut, std::string& strFailReason, bool lockUnspents, const std::set<int>& setSubtractFeeFromOutputs, CCoinControl coinControl)
@@ -2884,41 +3189,6 @@ OutputType CWallet::TransactionChangeType(OutputType change_type, const std::vec
 }
 
 
-std::map<CKeyID, int> CWallet::GetSpendableCount() const
-{
-    std::map<CKeyID, int> utxo;
-
-    LOCK2(cs_main, cs_wallet);
-
-    for (const auto& entry : mapWallet)
-    {
-        const uint256& wtxid = entry.first;
-        const CWalletTx* pcoin = &entry.second;
-
-        if (!pcoin->IsTrusted())
-            continue;
-
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++)
-        {
-            if (IsSpent(wtxid, i))
-                continue;
-
-            CTxDestination address;
-            if (!ExtractDestination(pcoin->tx->vout[i].scriptPubKey, address))
-                continue;
-
-            CPubKey pubkey;
-
-            if (!GetPubKey(address, pubkey))
-                continue;
-
-            utxo[pubkey.GetID()] += 1;
-        }
-    }
-
-    return utxo;
-};
-
 bool CWallet::AllowSign(CTransaction const & tx, std::string& strFailReason)
 {
     std::map<CKeyID, int> map_count;
@@ -2942,8 +3212,6 @@ bool CWallet::AllowSign(CTransaction const & tx, std::string& strFailReason)
         ProduceSignature(counter, scriptPubKey, sigdata);
     }
 
-    std::map<CKeyID, int> mapUtxo = GetSpendableCount();
-
     for (auto & x : map_count)
     {
         CPubKey pkey;
@@ -2962,7 +3230,7 @@ bool CWallet::AllowSign(CTransaction const & tx, std::string& strFailReason)
             return false;
         }
 
-        size_t utxo_count = mapUtxo[pkey.GetID()];
+        size_t utxo_count = GetKeyTxoCount(pkey.GetID());
 
         if (!CKey::force_signing)
         {
@@ -3314,6 +3582,39 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
         
         if (nChangePosInOut == -1) reservekey.ReturnKey(); // Return any reserved key if we don't have change
 
+        // The limits below are checked on the dummy signed transaction, which
+        // has the size of the signed one, so that no XMSS leaf is spent on a
+        // transaction that is rejected afterwards.
+        CMutableTransaction txCheck(txNew);
+        if (sign && !DummySignTx(txCheck, setCoins))
+        {
+            strFailReason = _("Signing transaction failed");
+            return false;
+        }
+
+        // Limit size
+        if (GetTransactionWeight(txCheck) >= MAX_STANDARD_TX_WEIGHT)
+        {
+            strFailReason = _("Transaction too large");
+            return false;
+        }
+
+        if (gArgs.GetBoolArg("-walletrejectlongchains", DEFAULT_WALLET_REJECT_LONG_CHAINS)) {
+            // Ensure this tx will pass the mempool's chain limits
+            LockPoints lp;
+            CTxMemPoolEntry entry(MakeTransactionRef(std::move(txCheck)), 0, 0, 0, false, 0, lp);
+            CTxMemPool::setEntries setAncestors;
+            size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+            size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
+            size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+            size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
+            std::string errString;
+            if (!mempool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
+                strFailReason = _("Transaction has too long of a mempool chain");
+                return false;
+            }
+        }
+
         if (sign)
         {
             CTransaction txNewConst(txNew);
@@ -3323,49 +3624,20 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
                 return false;
             }
 
-            int nIn = 0;
+            std::vector<CTxOut> vSpent;
+            vSpent.reserve(setCoins.size());
             for (const auto& coin : setCoins)
-            {
-                const CScript& scriptPubKey = coin.txout.scriptPubKey;
-                SignatureData sigdata;
-
-                if (!ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, coin.txout.nValue, SIGHASH_ALL), scriptPubKey, sigdata))
-                {
-                    strFailReason = _("Signing transaction failed");
-                    return false;
-                } else {
-                    UpdateTransaction(txNew, nIn, sigdata);
-                }
+                vSpent.push_back(coin.txout);
 
-                nIn++;
+            if (!SignTransactionInputs(*this, txNew, vSpent, SIGHASH_ALL, std::max(gArgs.GetArg("-xmsssignthreads", DEFAULT_XMSS_SIGN_THREADS), (int64_t) 0)))
+            {
+                strFailReason = _("Signing transaction failed");
+                return false;
             }
         }
 
         // Embed the constructed transaction data in wtxNew.
         wtxNew.SetTx(MakeTransactionRef(std::move(txNew)));
-
-        // Limit size
-        if (GetTransactionWeight(*wtxNew.tx) >= MAX_STANDARD_TX_WEIGHT)
-        {
-            strFailReason = _("Transaction too large");
-            return false;
-        }
-    }
-
-    if (gArgs.GetBoolArg("-walletrejectlongchains", DEFAULT_WALLET_REJECT_LONG_CHAINS)) {
-        // Lastly, ensure this tx will pass the mempool's chain limits
-        LockPoints lp;
-        CTxMemPoolEntry entry(wtxNew.tx, 0, 0, 0, false, 0, lp);
-        CTxMemPool::setEntries setAncestors;
-        size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
-        size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
-        size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
-        size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
-        std::string errString;
-        if (!mempool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
-            strFailReason = _("Transaction has too long of a mempool chain");
-            return false;
-        }
     }
 	
     LogPrintf("Fee Calculation: Fee:%d Bytes:%u Needed:%d Tgt:%d (requested %d) Reason:\"%s\" Decay %.5f: Estimation: (%g - %g) %.2f%% %.1f/(%.1f %d mem %.1f out) Fail: (%g - %g) %.2f%% %.1f/(%.1f %d mem %.1f out)\n",
@@ -3470,11 +3742,14 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
     }
 
     // This wallet is in its first run if all of these are empty
-    fFirstRunRet = mapKeys.empty() && mapCryptedKeys.empty() && mapWatchKeys.empty() && setWatchOnly.empty() && mapScripts.empty();
+    fFirstRunRet = mapKeys.empty() && mapCompactKeys.empty() && mapLazyKeys.empty() && mapCryptedKeys.empty() && mapWatchKeys.empty() && setWatchOnly.empty() && mapScripts.empty();
 
     if (nLoadWalletRet != DB_LOAD_OK)
         return nLoadWalletRet;
 
+    // transactions are loaded before the keys they pay to
+    RebuildKeyTxoIndex();
+
     uiInterface.LoadWallet(this);
 
     return DB_LOAD_OK;
@@ -3489,6 +3764,7 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
          wtxOrdered.erase(it->second.m_it_wtxOrdered);
          mapWallet.erase(it);
      }
+    RebuildKeyTxoIndex();
 
     if (nZapSelectTxRet == DB_NEED_REWRITE)
     {
@@ -3611,6 +3887,16 @@ bool CWallet::NewKeyPool()
 
         m_pool_key_to_index.clear();
 
+        // pregenerated XMSS keys stay in the wallet, but are not handed out anymore
+        for (const auto& entry : m_xmss_keypool) {
+            for (int64_t nIndex : entry.second) {
+                walletdb.EraseXMSSPool(nIndex);
+            }
+        }
+        m_xmss_keypool.clear();
+        m_xmss_pool_key_to_index.clear();
+        NotifyXMSSKeyPool();
+
         if (!TopUpKeyPool()) {
             return false;
         }
@@ -3762,6 +4048,223 @@ void CWallet::ReturnKey(int64_t nIndex, bool fInternal, const CPubKey& pubkey)
     LogPrintf("keypool return %d\n", nIndex);
 }
 
+void CWallet::LoadXMSSKeyPool(int64_t nIndex, const CKeyPool &keypool)
+{
+    AssertLockHeld(cs_wallet);
+    CKeyType keytype = keypool.vchPubKey.GetKeyType();
+    m_xmss_keypool[keytype].insert(nIndex);
+    m_xmss_keypool_types.insert(keytype);
+    m_max_xmss_keypool_index = std::max(m_max_xmss_keypool_index, nIndex);
+    m_xmss_pool_key_to_index[keypool.vchPubKey.GetID()] = nIndex;
+}
+
+size_t CWallet::GetXMSSKeyPoolSize(CKeyType keytype)
+{
+    LOCK(cs_wallet);
+    auto it = m_xmss_keypool.find(keytype);
+    return it != m_xmss_keypool.end() ? it->second.size() : 0;
+}
+
+bool CWallet::ReserveXMSSKeyFromPool(CPubKey& result, CKeyType keytype)
+{
+    AssertLockHeld(cs_wallet);
+
+    std::set<int64_t>& setKeyPool = m_xmss_keypool[keytype];
+    if (setKeyPool.empty())
+        return false;
+
+    CWalletDB walletdb(*dbw);
+
+    // Get the oldest key
+    int64_t nIndex = *setKeyPool.begin();
+    CKeyPool keypool;
+    if (!walletdb.ReadXMSSPool(nIndex, keypool)) {
+        throw std::runtime_error(std::string(__func__) + ": read failed");
+    }
+    if (!HaveKey(keypool.vchPubKey.GetID())) {
+        throw std::runtime_error(std::string(__func__) + ": unknown key in key pool");
+    }
+    if (keypool.vchPubKey.GetKeyType() != keytype) {
+        throw std::runtime_error(std::string(__func__) + ": keypool entry misclassified");
+    }
+
+    RemoveXMSSKeyFromPool(walletdb, keypool.vchPubKey.GetID());
+    result = keypool.vchPubKey;
+    LogPrintf("xmss keypool keep %d\n", nIndex);
+    return true;
+}
+
+void CWallet::RemoveXMSSKeyFromPool(CWalletDB& walletdb, const CKeyID& keyid)
+{
+    AssertLockHeld(cs_wallet);
+
+    auto it = m_xmss_pool_key_to_index.find(keyid);
+    if (it == m_xmss_pool_key_to_index.end())
+        return;
+
+    int64_t nIndex = it->second;
+    for (auto& entry : m_xmss_keypool) {
+        entry.second.erase(nIndex);
+    }
+    m_xmss_pool_key_to_index.erase(it);
+    walletdb.EraseXMSSPool(nIndex);
+}
+
+size_t CWallet::NeedXMSSKeyPoolTopUp(CKeyType& keytype)
+{
+    AssertLockHeld(cs_wallet);
+
+    if (IsLocked())
+        return 0;
+
+    size_t nTargetSize = std::max(gArgs.GetArg("-xmsskeypool", DEFAULT_XMSS_KEYPOOL_SIZE), (int64_t) 0);
+    for (CKeyType type : m_xmss_keypool_types) {
+        // Building one of these takes minutes, which would hold up shutdown
+        // for a key that may never be asked for
+        if (type == CKeyType::XMSS_256_H20)
+            continue;
+        if (m_xmss_keypool[type].size() < nTargetSize) {
+            keytype = type;
+            return nTargetSize - m_xmss_keypool[type].size();
+        }
+    }
+    return 0;
+}
+
+bool CWallet::AddXMSSKeyToPool(CWalletDB& walletdb, const CKey& secret, const CPubKey& pubkey)
+{
+    AssertLockHeld(cs_wallet);
+
+    int64_t nCreationTime = GetTime();
+    mapKeyUseCount[pubkey.GetID()] = 0;
+    mapKeyMetadata[pubkey.GetID()] = CKeyMetadata(nCreationTime);
+    UpdateTimeFirstKey(nCreationTime);
+
+    if (!AddKeyPubKeyWithDB(walletdb, secret, pubkey)) {
+        return error("%s: AddKey failed", __func__);
+    }
+    SetMinVersion(FEATURE_XMSS);
+
+    assert(m_max_xmss_keypool_index < std::numeric_limits<int64_t>::max());
+    int64_t index = ++m_max_xmss_keypool_index;
+    if (!walletdb.WriteXMSSPool(index, CKeyPool(pubkey, false))) {
+        return error("%s: writing generated key failed", __func__);
+    }
+
+    m_xmss_keypool[pubkey.GetKeyType()].insert(index);
+    m_xmss_pool_key_to_index[pubkey.GetID()] = index;
+    LogPrintf("xmss keypool added key %d (%s), size=%u\n", index, KeyTypeToString(pubkey.GetKeyType()), m_xmss_keypool[pubkey.GetKeyType()].size());
+    return true;
+}
+
+void CWallet::NotifyXMSSKeyPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_xmss_keypool_mutex);
+        m_xmss_keypool_wakeup = true;
+    }
+    m_xmss_keypool_cond.notify_all();
+}
+
+void CWallet::ThreadXMSSKeyPool()
+{
+    int nThreads = gArgs.GetArg("-xmsskeypoolthreads", DEFAULT_XMSS_KEYPOOL_THREADS);
+    if (nThreads <= 0)
+        nThreads = std::max(GetNumCores() - 1, 1);
+    nThreads = std::min(nThreads, MAX_XMSS_KEYPOOL_THREADS);
+
+    while (true) {
+        CKeyType keytype;
+        size_t nMissing;
+        {
+            LOCK(cs_wallet);
+            nMissing = NeedXMSSKeyPoolTopUp(keytype);
+        }
+
+        if (nMissing == 0) {
+            // Wait for a key to be taken from the pool or the wallet to be unlocked
+            std::unique_lock<std::mutex> lock(m_xmss_keypool_mutex);
+            m_xmss_keypool_cond.wait_for(lock, std::chrono::minutes(1), [this] { return m_xmss_keypool_interrupt || m_xmss_keypool_wakeup; });
+            if (m_xmss_keypool_interrupt)
+                return;
+            m_xmss_keypool_wakeup = false;
+            continue;
+        }
+
+        // Building the trees is the expensive part, do it without holding cs_wallet
+        std::vector<CKey> keys(std::min(nMissing, (size_t)nThreads), CKey(this));
+        if (!CKey::MakeNewKeys(keys, keytype, nThreads, &m_xmss_keypool_interrupt) || m_xmss_keypool_interrupt)
+            return;
+
+        {
+            LOCK(cs_wallet);
+            // The wallet may have been locked while the keys were generated
+            if (IsLocked())
+                continue;
+            CWalletDB walletdb(*dbw);
+            for (const CKey& secret : keys) {
+                CPubKey pubkey = secret.GetPubKey();
+                assert(secret.VerifyPubKey(pubkey));
+                if (!AddXMSSKeyToPool(walletdb, secret, pubkey)) {
+                    LogPrintf("%s: stopping, the XMSS keypool can not be topped up\n", __func__);
+                    return;
+                }
+            }
+        }
+
+        // Signalled without cs_wallet, which waiters take after releasing the mutex
+        {
+            std::lock_guard<std::mutex> lock(m_xmss_keypool_mutex);
+            ++m_xmss_keypool_added;
+        }
+        m_xmss_keypool_added_cond.notify_all();
+    }
+}
+
+bool CWallet::WaitForXMSSKeyPoolSize(CKeyType keytype, size_t nSize, int64_t nTimeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(nTimeout);
+    std::unique_lock<std::mutex> lock(m_xmss_keypool_mutex);
+    while (true) {
+        // Read the batch count before the size, so a batch added in between is not missed
+        uint64_t nAdded = m_xmss_keypool_added;
+        lock.unlock();
+        if (GetXMSSKeyPoolSize(keytype) >= nSize)
+            return true;
+        lock.lock();
+        if (!m_xmss_keypool_added_cond.wait_until(lock, deadline, [&] { return m_xmss_keypool_added != nAdded; }))
+            return false;
+    }
+}
+
+void CWallet::StartXMSSKeyPool()
+{
+    if (gArgs.GetArg("-xmsskeypool", DEFAULT_XMSS_KEYPOOL_SIZE) <= 0 || m_xmss_keypool_thread.joinable())
+        return;
+
+    {
+        LOCK(cs_wallet);
+        for (OutputType output_type : {g_address_type, g_change_type}) {
+            if (IsOutputTypeXMSS(output_type))
+                m_xmss_keypool_types.insert(KeyTypeFromOutputType(output_type));
+        }
+    }
+
+    m_xmss_keypool_interrupt = false;
+    m_xmss_keypool_thread = std::thread(&TraceThread<std::function<void()> >, "xmsskeypool", std::function<void()>(std::bind(&CWallet::ThreadXMSSKeyPool, this)));
+}
+
+void CWallet::StopXMSSKeyPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_xmss_keypool_mutex);
+        m_xmss_keypool_interrupt = true;
+    }
+    m_xmss_keypool_cond.notify_all();
+    if (m_xmss_keypool_thread.joinable())
+        m_xmss_keypool_thread.join();
+}
+
 bool CWallet::GetPubKey(const CKeyID &address, CPubKey &result) const
 {
     return CCryptoKeyStore::GetPubKey(address, result);
@@ -3818,10 +4321,43 @@ size_t CWallet::GetLeftKeyUses(const CKeyID &keyid) const
         return 0;
 
     long use_count = GetKeyUseCount(keyid);
-    long txo_count = 0; // TODO: 
+    long txo_count = GetKeyTxoCount(keyid);
     long max_use_count = pubkey.GetMaxUseCount();
 
-    return max_use_count - use_count - txo_count;
+    return std::max(max_use_count - use_count - txo_count, 0L);
+}
+
+size_t CWallet::GetKeyTxoCount(const CKeyID &address) const
+{
+    LOCK(cs_wallet);
+
+    auto it = mapKeyTxoCount.find(address);
+    return it != mapKeyTxoCount.end() ? it->second : 0;
+}
+
+uint64_t CWallet::GetKeyUseCountInc(const CKeyID &address)
+{
+    LOCK2(cs_wallet, cs_KeyStore);
+
+    uint64_t use_count = GetKeyUseCount(address);
+    if (use_count >= mapKeyUseReserved[address])
+    {
+        // the index has to be on disk before a signature made with it leaves the wallet
+        CPubKey pubkey;
+        if (!GetPubKey(address, pubkey))
+            throw std::runtime_error(strprintf("%s: unknown key %s", __func__, address.ToString()));
+
+        uint64_t reserved = use_count + std::max<int64_t>(gArgs.GetArg("-xmssleafreserve", DEFAULT_XMSS_LEAF_RESERVE), 1);
+        if (pubkey.IsXMSS())
+            reserved = std::min<uint64_t>(reserved, std::max<uint64_t>(pubkey.GetMaxUseCount(), use_count + 1));
+
+        CWalletDB walletdb(*dbw);
+        if (!WriteKeyUseReserved(walletdb, pubkey, reserved))
+            throw std::runtime_error(strprintf("%s: failed to reserve leaf indices of key %s", __func__, address.ToString()));
+    }
+
+    mapKeyUseCount[address] = use_count + 1;
+    return use_count;
 }
 
 bool CWallet::SetKeyUseCount(const CKeyID &address, uint64_t use_count)
@@ -3829,32 +4365,51 @@ bool CWallet::SetKeyUseCount(const CKeyID &address, uint64_t use_count)
 	if (!CCryptoKeyStore::SetKeyUseCount(address, use_count))
 		return false;
 	
-    LOCK(cs_wallet);
+    LOCK2(cs_wallet, cs_KeyStore);
+
+	// indices below the reserved limit are on disk already
+	if (use_count <= mapKeyUseReserved[address])
+		return true;
 
 	CPubKey pubkey;
 	if (!GetPubKey(address, pubkey)	)
 		return false;
 	
 	CWalletDB walletdb(*dbw);
-	if (!walletdb.WriteKeyUseCount(pubkey, use_count))
-		return false;
-
-	return true;
+	return WriteKeyUseReserved(walletdb, pubkey, use_count);
 }
 
-void CWallet::UpdateUseCount(
-	std::vector<unsigned char> const & sig,
-	std::vector<unsigned char> const & vPubKey, 
-	uint64_t use_count,
-	CWalletDB & walletdb)
+bool CWallet::WriteKeyUseReserved(CWalletDB& walletdb, const CPubKey& pubkey, uint64_t reserved)
 {
-	CPubKey pubkey(vPubKey);
+    AssertLockHeld(cs_KeyStore);
 
+    uint64_t& nReserved = mapKeyUseReserved[pubkey.GetID()];
+    if (reserved <= nReserved)
+        return true;
+    if (!walletdb.WriteKeyUseCount(pubkey, reserved))
+        return false;
+    nReserved = reserved;
+    return true;
+}
+
+void CWallet::UpdateUseCount(CPubKey const & pubkey, uint64_t use_count, CWalletDB & walletdb)
+{
 	CKeyID keyid = pubkey.GetID();
 
+	// inputs of other wallets can show up next to ours
+	if (!HaveKey(keyid))
+		return;
+
 	if (CCryptoKeyStore::SetKeyUseCount(keyid, use_count))
 	{
-		if (!walletdb.WriteKeyUseCount(pubkey, use_count))
+		if (fBatchKeyUseCounts)
+		{
+			setKeyUseCountDirty.insert(keyid);
+			return;
+		}
+
+		LOCK(cs_KeyStore);
+		if (!WriteKeyUseReserved(walletdb, pubkey, use_count))
 		{
 			LogPrintf("%s: replacing use_count by use_count from transaction failed\n", __func__);
 		}
@@ -3867,59 +4422,85 @@ void CWallet::UpdateUseCount(
 
 void CWallet::UpdateUseCount(CWalletTx const & wtx, CWalletDB & walletdb)
 {
+	std::vector<std::pair<CPubKey, int64_t>> vSigs;
+
 	for (unsigned int i = 0; i < wtx.tx->vin.size(); ++i)
 	{
 		CTxIn const & txin = wtx.tx->vin[i];
-		
-		auto mi = mapWallet.find(txin.prevout.hash);
-		if (mi == mapWallet.end())
-		{
-			continue;
-		}
-		
-		const CWalletTx & tx_prev = mi->second;
-		if (txin.prevout.n >= tx_prev.tx->vout.size())
-		{
-			continue;
-		}
-		
-	    const CScript & scriptPubKey = tx_prev.tx->vout[txin.prevout.n].scriptPubKey;
-		
-	    const CScript & scriptSig = txin.scriptSig;
-		const CScriptWitness & witness = txin.scriptWitness;
-		
-		CollectorSignatureChecker checker;
-		
-		bool bValid = VerifyScript(scriptSig, scriptPubKey, &witness, 
-			SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS, 
-			checker, nullptr);
-		
-		if (!bValid)
+
+		// the known witness templates are read directly, anything else is
+		// run through the script interpreter to find its signatures
+		if (!ExtractXMSSSignatures(txin.scriptWitness, vSigs))
 		{
-			continue;
+			vSigs.clear();
+
+			auto mi = mapWallet.find(txin.prevout.hash);
+			if (mi == mapWallet.end())
+			{
+				continue;
+			}
+			
+			const CWalletTx & tx_prev = mi->second;
+			if (txin.prevout.n >= tx_prev.tx->vout.size())
+			{
+				continue;
+			}
+			
+			const CScript & scriptPubKey = tx_prev.tx->vout[txin.prevout.n].scriptPubKey;
+			
+			CollectorSignatureChecker checker;
+			
+			bool bValid = VerifyScript(txin.scriptSig, scriptPubKey, &txin.scriptWitness, 
+				SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS, 
+				checker, nullptr);
+			
+			if (!bValid)
+			{
+				continue;
+			}
+
+			for ( auto && p : checker.m_signatures)
+			{
+				if (bpqcrypto::is_xmss_pubkey(p.first))
+					vSigs.emplace_back(CPubKey(p.first), xmss_get_use_count_from_der_sig(p.second));
+			}
 		}
 
-		for ( auto && p : checker.m_signatures)
+		for (auto && p : vSigs)
 		{
-			auto && vPubKey = p.first;
-            if (bpqcrypto::is_xmss_pubkey(vPubKey))
-            {
-    			auto && vSig = p.second;
-                
-                int64_t use_count = xmss_get_use_count_from_der_sig(vSig);
-                if (use_count < 0)
-                {
-                    continue;
-                }
-                
-                use_count += 1;
+			if (p.second < 0)
+				continue;
 
-                UpdateUseCount(vSig, vPubKey, use_count, walletdb);
-            }
+			UpdateUseCount(p.first, p.second + 1, walletdb);
 		}
 	}
 }
 
+void CWallet::WriteKeyUseCounts()
+{
+	AssertLockHeld(cs_wallet);
+
+	fBatchKeyUseCounts = false;
+	if (setKeyUseCountDirty.empty())
+		return;
+
+	CWalletDB walletdb(*dbw);
+	LOCK(cs_KeyStore);
+
+	walletdb.TxnBegin();
+	for (const CKeyID & keyid : setKeyUseCountDirty)
+	{
+		CPubKey pubkey;
+		if (!GetPubKey(keyid, pubkey) || !WriteKeyUseReserved(walletdb, pubkey, GetKeyUseCount(keyid)))
+			LogPrintf("%s: writing use_count of key %s failed\n", __func__, keyid.ToString());
+	}
+	if (!walletdb.TxnCommit())
+		LogPrintf("%s: committing use_counts failed\n", __func__);
+
+	LogPrint(BCLog::DB, "%s: wrote use_count of %u keys\n", __func__, setKeyUseCountDirty.size());
+	setKeyUseCountDirty.clear();
+}
+
 bool CWallet::GetNewKey(CPubKey& result, CKeyType keytype, bool internal)
 {
     if (keytype == CKeyType::ECDSA_COMPRESSED ||
@@ -3933,6 +4514,16 @@ bool CWallet::GetNewKey(CPubKey& result, CKeyType keytype, bool internal)
 		if (IsLocked()) 
 			return false;
 
+		// keep keys of this type pregenerated from now on
+		if (IsKeyTypeXMSS(keytype))
+		{
+			m_xmss_keypool_types.insert(keytype);
+			bool fPooled = ReserveXMSSKeyFromPool(result, keytype);
+			NotifyXMSSKeyPool();
+			if (fPooled)
+				return true;
+		}
+
 		CWalletDB walletdb(*dbw);
 		result = GenerateNewKey(walletdb, keytype, internal);
 		return true;
@@ -4655,6 +5246,8 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
         }
     }
     walletInstance->SetBroadcastTransactions(gArgs.GetBoolArg("-walletbroadcast", DEFAULT_WALLETBROADCAST));
+    walletInstance->SetCompactXMSSKeys(gArgs.GetBoolArg("-xmsscompactkeys", DEFAULT_XMSS_COMPACT_KEYS));
+    walletInstance->SetXMSSKeyCacheSize(std::max(gArgs.GetArg("-xmsskeycache", DEFAULT_XMSS_KEY_CACHE_SIZE), (int64_t) 0) << 20);
 
     {
         LOCK(walletInstance->cs_wallet);
@@ -4678,6 +5271,8 @@ void CWallet::postInitProcess(CScheduler& scheduler)
     if (!CWallet::fFlushScheduled.exchange(true)) {
         scheduler.scheduleEvery(MaybeCompactWalletDB, 500);
     }
+
+    StartXMSSKeyPool();
 }
 
 bool CWallet::BackupWallet(const std::string& strDest)
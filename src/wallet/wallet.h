@@ -22,12 +22,15 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -52,6 +55,24 @@ extern bool bSpendZeroConfChange;
 extern bool fWalletRbf;
 
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 8; // BPQ, keypool contains only legacy addresses
+//! -xmsskeypool default, number of pregenerated XMSS keys per key type in use
+static const unsigned int DEFAULT_XMSS_KEYPOOL_SIZE = 4;
+//! -xmsskeypoolthreads default. Kept small, a background refill should not take over the machine
+static const int DEFAULT_XMSS_KEYPOOL_THREADS = 2;
+//! Maximum number of threads building XMSS keys for the keypool
+static const int MAX_XMSS_KEYPOOL_THREADS = 16;
+//! -xmssleafreserve default, number of XMSS leaf indices reserved per database write
+static const unsigned int DEFAULT_XMSS_LEAF_RESERVE = 16;
+//! -xmsscompactkeys default, whether unencrypted XMSS key records leave out their hash tree
+static const bool DEFAULT_XMSS_COMPACT_KEYS = false;
+//! -xmsssignthreads default, 0 = one per core
+static const int DEFAULT_XMSS_SIGN_THREADS = 0;
+//! -rescanthreads default, 0 = one per core
+static const int DEFAULT_RESCAN_THREADS = 0;
+//! Number of blocks a rescan reads and matches ahead of the block it adds to the wallet
+static const unsigned int RESCAN_PREFETCH_BLOCKS = 32;
+//! Number of blocks a rescan looks up in the block index at once
+static const unsigned int RESCAN_CHUNK_BLOCKS = 2000;
 
 //! -paytxfee default
 static const CAmount DEFAULT_TRANSACTION_FEE = 0;
@@ -712,6 +733,8 @@ private:
     int64_t nNextResend;
     int64_t nLastResend;
     bool fBroadcastTransactions;
+    //! Store XMSS keys in compact form, see ReadLazyKey
+    bool fCompactXMSSKeys;
 
     /**
      * Used to keep track of spent outpoints, and
@@ -723,6 +746,21 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Unspent wallet outputs by the XMSS key they pay to. Spending each of
+     * them takes a leaf of its own, so GetLeftKeyUses() and the signing checks
+     * count them against the capacity of the key. Outputs are spent as by
+     * IsSpent(), outputs of abandoned or conflicted transactions are left out.
+     * Kept up to date by AddToWallet(), SyncTransaction(), MarkConflicted()
+     * and AbandonTransaction(), so the wallet does not have to be scanned to
+     * answer how many leaves a key still has.
+     */
+    std::map<COutPoint, CKeyID> mapKeyTxos;
+    std::map<CKeyID, size_t> mapKeyTxoCount;
+    void UpdateKeyTxo(const COutPoint& outpoint);
+    void UpdateKeyTxos(const CWalletTx& wtx);
+    void RebuildKeyTxoIndex();
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 
@@ -743,6 +781,44 @@ private:
     int64_t m_max_keypool_index;
     std::map<CKeyID, int64_t> m_pool_key_to_index;
 
+    /**
+     * Pregenerated XMSS keys by key type. Building an XMSS tree takes seconds
+     * for larger trees, so ThreadXMSSKeyPool() builds them in the background
+     * for every key type in m_xmss_keypool_types and GetNewKey() hands them out.
+     * XMSS_256_H20 trees take minutes and are only built on demand.
+     */
+    std::map<CKeyType, std::set<int64_t>> m_xmss_keypool;
+    std::map<CKeyID, int64_t> m_xmss_pool_key_to_index;
+    std::set<CKeyType> m_xmss_keypool_types;
+    int64_t m_max_xmss_keypool_index;
+
+    std::thread m_xmss_keypool_thread;
+    std::mutex m_xmss_keypool_mutex;
+    std::condition_variable m_xmss_keypool_cond;
+    //! Set under m_xmss_keypool_mutex, read without it by the key generating threads
+    std::atomic<bool> m_xmss_keypool_interrupt;
+    bool m_xmss_keypool_wakeup;
+    //! Counts the batches of keys added by ThreadXMSSKeyPool(), signalled on m_xmss_keypool_added_cond
+    uint64_t m_xmss_keypool_added;
+    std::condition_variable m_xmss_keypool_added_cond;
+
+    bool ReserveXMSSKeyFromPool(CPubKey& result, CKeyType keytype);
+    void RemoveXMSSKeyFromPool(CWalletDB& walletdb, const CKeyID& keyid);
+    size_t NeedXMSSKeyPoolTopUp(CKeyType& keytype);
+    bool AddXMSSKeyToPool(CWalletDB& walletdb, const CKey& secret, const CPubKey& pubkey);
+    void NotifyXMSSKeyPool();
+    void ThreadXMSSKeyPool();
+
+    /**
+     * Leaf indices of each XMSS key that are reserved on disk. The "keyuses"
+     * record holds this limit instead of the use count, so GetKeyUseCountInc()
+     * only writes once per -xmssleafreserve signatures, and after a crash the
+     * wallet continues past the whole reserved range. Guarded by cs_KeyStore.
+     */
+    std::map<CKeyID, uint64_t> mapKeyUseReserved;
+
+    bool WriteKeyUseReserved(CWalletDB& walletdb, const CPubKey& pubkey, uint64_t reserved);
+
     int64_t nTimeFirstKey;
 
     /**
@@ -778,9 +854,17 @@ protected:
 	 * cs_wallet already is locked
 	 */
 	void UpdateUseCount(CWalletTx const & tx, CWalletDB & walletdb);
-	void UpdateUseCount(std::vector<unsigned char> const & sig, 
-		std::vector<unsigned char> const & pubkey, uint64_t use_count, 
-		CWalletDB & walletdb);
+	void UpdateUseCount(CPubKey const & pubkey, uint64_t use_count, CWalletDB & walletdb);
+
+	/*
+	 * while a block is connected or rescanned the use counts seen in its
+	 * transactions are only noted here, WriteKeyUseCounts() writes them
+	 * in one database transaction at the end of the block
+	 * guarded by cs_wallet
+	 */
+	bool fBatchKeyUseCounts = false;
+	std::set<CKeyID> setKeyUseCountDirty;
+	void WriteKeyUseCounts();
 
 public:
     /*
@@ -834,6 +918,7 @@ public:
 
     ~CWallet()
     {
+        StopXMSSKeyPool();
         delete pwalletdbEncryption;
         pwalletdbEncryption = nullptr;
     }
@@ -849,8 +934,13 @@ public:
         nNextResend = 0;
         nLastResend = 0;
         m_max_keypool_index = 0;
+        m_max_xmss_keypool_index = 0;
+        m_xmss_keypool_interrupt = false;
+        m_xmss_keypool_wakeup = false;
+        m_xmss_keypool_added = 0;
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
+        fCompactXMSSKeys = DEFAULT_XMSS_COMPACT_KEYS;
         nRelockTime = 0;
         fAbortRescan = false;
         fScanningWallet = false;
@@ -927,7 +1017,9 @@ public:
     
 	bool GetKey(const CKeyID &address, CKey& keyOut) const override;
 
+    uint64_t GetKeyUseCountInc(const CKeyID &address) override;
     bool SetKeyUseCount(const CKeyID &address, uint64_t use_count) override;
+    size_t GetKeyTxoCount(const CKeyID &address) const override;
     size_t GetLeftKeyUses(const CKeyID &addres) const;
 	
     /**
@@ -941,6 +1033,8 @@ public:
     bool AddKeyPubKeyWithDB(CWalletDB &walletdb,const CKey& key, const CPubKey &pubkey);
     //! Adds a key to the store, without saving it to disk (used by LoadWallet)
     bool LoadKey(const CKey& key, const CPubKey &pubkey) { return CCryptoKeyStore::AddKeyPubKey(key, pubkey); }
+    //! Reads the secret of a lazily loaded XMSS key from the wallet database
+    bool ReadLazyKey(const CPubKey &pubkey, CKeyingMaterial& vchSecret) const override;
     //! Load metadata (used by LoadWallet)
     bool LoadKeyMetadata(const CKeyID& keyID, const CKeyMetadata & metadata);
     //! Load hashtree (used by LoadWallet)
@@ -999,7 +1093,8 @@ public:
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
-    bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
+    /** fCheckIsMine = false skips checking the outputs, for a caller that already found none of them to be ours */
+    bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate, bool fCheckIsMine = true);
     int64_t RescanFromTime(int64_t startTime, const WalletRescanReserver& reserver, bool update, bool xmss_only);
     void RescanMemPoolForNewKey(CPubKey const & pubkey);
     CBlockIndex* ScanForWalletTransactions(CBlockIndex* pindexStart, CBlockIndex* pindexStop, const WalletRescanReserver& reserver, bool fUpdate = false);
@@ -1027,7 +1122,6 @@ public:
     bool FundTransaction(CMutableTransaction& tx, CAmount& nFeeRet, int& nChangePosInOut, std::string& strFailReason, bool lockUnspents, const std::set<int>& setSubtractFeeFromOutputs, CCoinControl);
     bool SignTransaction(CMutableTransaction& tx);
 
-    std::map<CKeyID, int> GetSpendableCount() const;
     bool AllowSign(CTransaction const & tx, std::string& strFailReason);
 
     /**
@@ -1065,6 +1159,14 @@ public:
     void MarkReserveKeysAsUsed(int64_t keypool_id);
     const std::map<CKeyID, int64_t>& GetAllReserveKeys() const { return m_pool_key_to_index; }
 
+    void LoadXMSSKeyPool(int64_t nIndex, const CKeyPool &keypool);
+    size_t GetXMSSKeyPoolSize(CKeyType keytype);
+    //! Wait up to nTimeout milliseconds for the XMSS keypool of keytype to hold nSize keys
+    bool WaitForXMSSKeyPoolSize(CKeyType keytype, size_t nSize, int64_t nTimeout);
+    //! Start/stop the thread that keeps the XMSS keypool filled (-xmsskeypool)
+    void StartXMSSKeyPool();
+    void StopXMSSKeyPool();
+
     std::set< std::set<CTxDestination> > GetAddressGroupings();
     std::map<CTxDestination, CAmount> GetAddressBalances();
 
@@ -1167,6 +1269,14 @@ public:
     /** Set whether this wallet broadcasts transactions. */
     void SetBroadcastTransactions(bool broadcast) { fBroadcastTransactions = broadcast; }
 
+    /**
+     * Set whether unencrypted XMSS key records are stored in compact form.
+     * Long records keep the hash tree, so a key that dropped out of the
+     * expanded key cache is read back instead of rebuilt; compact ones save
+     * the disk space.
+     */
+    void SetCompactXMSSKeys(bool fCompact) { fCompactXMSSKeys = fCompact; }
+
     /** Return whether transaction can be abandoned */
     bool TransactionCanBeAbandoned(const uint256& hashTx) const;
 
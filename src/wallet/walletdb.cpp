@@ -68,6 +68,11 @@ bool CWalletDB::WriteKeyUseCount(const CPubKey& vchPubKey, uint64_t use_count)
 	return true;
 }
 
+bool CWalletDB::ReadKeyUseCount(const CPubKey& vchPubKey, uint64_t& use_count)
+{
+    return batch.Read(std::make_pair(std::string("keyuses"), vchPubKey), use_count);
+}
+
 bool CWalletDB::WriteKey(
 	const CPubKey& vchPubKey, 
 	const CPrivKey& vchPrivKey, 
@@ -91,6 +96,35 @@ bool CWalletDB::WriteKey(
     return true;
 }
 
+bool CWalletDB::ReadKey(const CPubKey& vchPubKey, CPrivKey& vchPrivKey)
+{
+    std::pair<CPrivKey, uint256> value;
+    if (!batch.Read(std::make_pair(std::string("key"), vchPubKey), value))
+        return false;
+
+    // the record is checked here as ReadKeyValue skips lazily loaded keys
+    std::vector<unsigned char> vchKey;
+    vchKey.reserve(vchPubKey.size() + value.first.size());
+    vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
+    vchKey.insert(vchKey.end(), value.first.begin(), value.first.end());
+    if (Hash(vchKey.begin(), vchKey.end()) != value.second) {
+        LogPrintf("%s: CPubKey/CPrivKey corrupt\n", __func__);
+        return false;
+    }
+    vchPrivKey = std::move(value.first);
+    return true;
+}
+
+bool CWalletDB::RewriteKey(const CPubKey& vchPubKey, const CPrivKey& vchPrivKey)
+{
+    std::vector<unsigned char> vchKey;
+    vchKey.reserve(vchPubKey.size() + vchPrivKey.size());
+    vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
+    vchKey.insert(vchKey.end(), vchPrivKey.begin(), vchPrivKey.end());
+
+    return WriteIC(std::make_pair(std::string("key"), vchPubKey), std::make_pair(vchPrivKey, Hash(vchKey.begin(), vchKey.end())), true);
+}
+
 bool CWalletDB::WriteCryptedKey(
 	const CPubKey& vchPubKey,
 	const std::vector<unsigned char>& vchCryptedSecret,
@@ -167,6 +201,21 @@ bool CWalletDB::ErasePool(int64_t nPool)
     return EraseIC(std::make_pair(std::string("pool"), nPool));
 }
 
+bool CWalletDB::ReadXMSSPool(int64_t nPool, CKeyPool& keypool)
+{
+    return batch.Read(std::make_pair(std::string("xmsspool"), nPool), keypool);
+}
+
+bool CWalletDB::WriteXMSSPool(int64_t nPool, const CKeyPool& keypool)
+{
+    return WriteIC(std::make_pair(std::string("xmsspool"), nPool), keypool);
+}
+
+bool CWalletDB::EraseXMSSPool(int64_t nPool)
+{
+    return EraseIC(std::make_pair(std::string("xmsspool"), nPool));
+}
+
 bool CWalletDB::WriteMinVersion(int nVersion)
 {
     return WriteIC(std::string("minversion"), nVersion);
@@ -355,6 +404,19 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                 strErr = "Error reading wallet database: CPubKey corrupt";
                 return false;
             }
+            if (vchPubKey.IsXMSS() && strType == "key")
+            {
+                // the record is neither parsed nor checked until the key is
+                // first used, see CWallet::ReadLazyKey
+                wss.nKeys++;
+                if (!pwallet->LoadLazyKey(vchPubKey))
+                {
+                    strErr = "Error reading wallet database: LoadLazyKey failed";
+                    return false;
+                }
+                return true;
+            }
+
             CKey key;
             CPrivKey pkey;
             uint256 hash;
@@ -401,12 +463,21 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                 fSkipCheck = true;
             }
 
-            if (!key.Load(pkey, vchPubKey, fSkipCheck))
+            if (vchPubKey.IsXMSS())
+            {
+                // XMSS keys stay compact until they are used, see CBasicKeyStore
+                if (!pwallet->LoadCompactKey(vchPubKey, CKeyingMaterial(pkey.begin(), pkey.end()), fSkipCheck))
+                {
+                    strErr = "Error reading wallet database: CPrivKey corrupt";
+                    return false;
+                }
+            }
+            else if (!key.Load(pkey, vchPubKey, fSkipCheck))
             {
                 strErr = "Error reading wallet database: CPrivKey corrupt";
                 return false;
             }
-            if (!pwallet->LoadKey(key, vchPubKey))
+            else if (!pwallet->LoadKey(key, vchPubKey))
             {
                 strErr = "Error reading wallet database: LoadKey failed";
                 return false;
@@ -495,6 +566,15 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
 
             pwallet->LoadKeyPool(nIndex, keypool);
         }
+        else if (strType == "xmsspool")
+        {
+            int64_t nIndex;
+            ssKey >> nIndex;
+            CKeyPool keypool;
+            ssValue >> keypool;
+
+            pwallet->LoadXMSSKeyPool(nIndex, keypool);
+        }
         else if (strType == "version")
         {
             ssValue >> wss.nFileVersion;
@@ -183,9 +183,13 @@ public:
     bool EraseTx(uint256 hash);
 
 	bool WriteKeyUseCount(const CPubKey& vchPubKey, uint64_t use_count);
+	bool ReadKeyUseCount(const CPubKey& vchPubKey, uint64_t& use_count);
 	
     bool WriteKey(const CPubKey& vchPubKey, const CPrivKey& vchPrivKey, 
 		const CKeyMetadata &keyMeta);
+    bool ReadKey(const CPubKey& vchPubKey, CPrivKey& vchPrivKey);
+    //! Replace the private key of an existing "key" record
+    bool RewriteKey(const CPubKey& vchPubKey, const CPrivKey& vchPrivKey);
     bool WriteCryptedKey(const CPubKey& vchPubKey, const std::vector<unsigned char>& vchCryptedSecret, 
 		const CKeyMetadata &keyMeta);
 	
@@ -205,6 +209,10 @@ public:
     bool WritePool(int64_t nPool, const CKeyPool& keypool);
     bool ErasePool(int64_t nPool);
 
+    bool ReadXMSSPool(int64_t nPool, CKeyPool& keypool);
+    bool WriteXMSSPool(int64_t nPool, const CKeyPool& keypool);
+    bool EraseXMSSPool(int64_t nPool);
+
     bool WriteMinVersion(int nVersion);
 
     /// This writes directly to the database, and will not update the CWallet's cached accounting entries!
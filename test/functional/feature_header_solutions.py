@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018 The Bitcoin Post-Quantum developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that served block headers keep their Equihash solutions.
+
+The block index does not hold solutions in memory, they are pinned until the
+next block index flush and read back from the block tree DB afterwards. Check
+that REST /headers, getblockheader and getheaders return complete headers
+before and after a restart.
+"""
+
+from io import BytesIO
+from struct import unpack
+import http.client
+import urllib.parse
+
+from test_framework.messages import deser_compact_size, hash256
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, bytes_to_hex_str, connect_nodes, sync_blocks
+
+BPQ_MAJOR_VERSION = 1
+
+def read_header(f):
+    """Read one serialized header and return its bytes and its block hash."""
+    start = f.tell()
+    major_version = unpack("<B", f.read(1))[0]
+    f.read(4 + 32 + 32 + 32 + 4 + 4 + 32)
+    f.read(deser_compact_size(f))
+    end = f.tell()
+    f.seek(start)
+    raw = f.read(end - start)
+    if major_version >= BPQ_MAJOR_VERSION:
+        # Post-fork headers commit to the whole header, including the solution
+        h = hash256(raw)
+    else:
+        # minor version, prev block, merkle root, time, bits, low nonce bytes
+        h = hash256(raw[1:69] + raw[101:113])
+    return raw, bytes_to_hex_str(h[::-1])
+
+class HeaderSolutionsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_network(self):
+        # Node 1 fetches the chain from node 0 after its restart
+        self.setup_nodes()
+
+    def rest_headers(self, count, start_hash):
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/rest/headers/%d/%s.bin' % (count, start_hash))
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        f = BytesIO(response.read())
+        headers = []
+        while f.tell() < len(f.getbuffer()):
+            headers.append(read_header(f))
+        return headers
+
+    def check_headers(self):
+        node = self.nodes[0]
+        height = node.getblockcount()
+        headers = self.rest_headers(height + 1, node.getblockhash(0))
+        assert_equal(len(headers), height + 1)
+        for i, (raw, block_hash) in enumerate(headers):
+            assert_equal(block_hash, node.getblockhash(i))
+            assert_equal(node.getblockheader(block_hash, False), bytes_to_hex_str(raw))
+        return headers
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("Mine across the fork height")
+        node.generate(120)
+
+        self.log.info("Headers with solutions pinned in memory round-trip")
+        before = self.check_headers()
+        # The solution of a post-fork header is not empty
+        assert len(before[-1][0]) > 1 + 4 + 32 + 32 + 32 + 4 + 4 + 32 + 1
+
+        self.log.info("Headers read back from the block tree DB round-trip after a restart")
+        self.restart_node(0)
+        assert_equal(self.check_headers(), before)
+
+        self.log.info("A peer syncs the chain through getheaders and checks the solutions")
+        connect_nodes(self.nodes[1], 0)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[1].getbestblockhash(), node.getbestblockhash())
+        for i in (1, 100, 101, 120):
+            assert_equal(self.nodes[1].getblockheader(self.nodes[1].getblockhash(i), False), bytes_to_hex_str(before[i][0]))
+
+if __name__ == '__main__':
+    HeaderSolutionsTest().main()
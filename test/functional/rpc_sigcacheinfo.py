@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018 The Bitcoin Post-Quantum developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getsigcacheinfo RPC.
+
+Test corresponds to code in rpc/blockchain.cpp and script/sigcache.cpp.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than
+
+FIELDS = ["hits", "misses", "inserts", "evictions", "maxentries"]
+
+class SigCacheInfoTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def total(self, info, field):
+        return info["ecdsa"][field] + info["xmss"][field]
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("Check the fields of both caches")
+        info = node.getsigcacheinfo()
+        assert_equal(sorted(info.keys()), ["ecdsa", "xmss"])
+        for tier in info.values():
+            assert_equal(sorted(tier.keys()), sorted(FIELDS))
+            for field in FIELDS:
+                assert_equal(type(tier[field]), int)
+                assert tier[field] >= 0
+            assert_greater_than(tier["maxentries"], 0)
+        # The XMSS tier gets the larger share of -maxsigcachesize
+        assert_greater_than(info["xmss"]["maxentries"], info["ecdsa"]["maxentries"])
+
+        self.log.info("Accepting a transaction to the mempool caches its signatures")
+        before = node.getsigcacheinfo()
+        node.sendtoaddress(node.getnewaddress(), 1)
+        after_mempool = node.getsigcacheinfo()
+        assert_greater_than(self.total(after_mempool, "inserts"), self.total(before, "inserts"))
+        assert_greater_than(self.total(after_mempool, "misses"), self.total(before, "misses"))
+
+        self.log.info("Connecting the block that confirms it hits the cache")
+        node.generate(1)
+        after_block = node.getsigcacheinfo()
+        assert_greater_than(self.total(after_block, "hits"), self.total(after_mempool, "hits"))
+        for field in FIELDS:
+            for tier in ["ecdsa", "xmss"]:
+                assert after_block[tier][field] >= after_mempool[tier][field]
+
+        self.log.info("-maxsigcachesize sets the capacity of both caches")
+        self.restart_node(0, ["-maxsigcachesize=64"])
+        bigger = self.nodes[0].getsigcacheinfo()
+        for tier in ["ecdsa", "xmss"]:
+            assert_greater_than(bigger[tier]["maxentries"], info[tier]["maxentries"])
+            assert_equal(bigger[tier]["hits"], 0)
+            assert_equal(bigger[tier]["inserts"], 0)
+
+if __name__ == '__main__':
+    SigCacheInfoTest().main()
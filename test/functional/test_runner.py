@@ -82,6 +82,7 @@ BASE_SCRIPTS= [
     'rpc_rawtransaction.py',
     'wallet_address_types.py',
     'feature_reindex.py',
+    'feature_header_solutions.py',
     # vv Tests less than 30s vv
     'wallet_keypool_topup.py', # BPQ: failed
     'interface_zmq.py',
@@ -127,6 +128,8 @@ BASE_SCRIPTS= [
     'feature_dersig.py',
     'feature_cltv.py',
     'rpc_uptime.py',
+    'rpc_sigcacheinfo.py',
+    'wallet_xmsskeys.py',
     'wallet_resendwallettransactions.py',
     'feature_minchainwork.py',
     'p2p_fingerprint.py',
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018 The Bitcoin Post-Quantum developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the listxmsskeys RPC.
+
+Every unspent output to an XMSS key takes one more signature to spend, so
+it is counted against the signatures the key has left.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than
+
+class XMSSKeysTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+
+    def get_key(self, node, address):
+        keys = [k for k in node.listxmsskeys() if k["address"] == address]
+        assert_equal(len(keys), 1)
+        key = keys[0]
+        assert_equal(key["left"], key["maxusecount"] - key["usecount"] - key["txocount"])
+        return key
+
+    def run_test(self):
+        self.nodes[0].generate(101)
+        self.sync_all()
+
+        self.log.info("A new key has all its signatures left")
+        address = self.nodes[1].getnewaddress()
+        key = self.get_key(self.nodes[1], address)
+        assert_equal(key["usecount"], 0)
+        assert_equal(key["txocount"], 0)
+        assert_equal(key["left"], key["maxusecount"])
+
+        self.log.info("Unspent outputs count against the key, confirmed or not")
+        self.nodes[0].sendtoaddress(address, 1)
+        self.nodes[0].sendtoaddress(address, 1)
+        self.sync_all()
+        key = self.get_key(self.nodes[1], address)
+        assert_equal(key["txocount"], 2)
+        assert_equal(key["left"], key["maxusecount"] - 2)
+        self.nodes[0].generate(1)
+        self.sync_all()
+        assert_equal(self.get_key(self.nodes[1], address)["txocount"], 2)
+
+        self.log.info("maxleft filters the keys with more signatures left")
+        assert address in [k["address"] for k in self.nodes[1].listxmsskeys(key["left"])]
+        assert address not in [k["address"] for k in self.nodes[1].listxmsskeys(key["left"] - 1)]
+        keys = self.nodes[1].listxmsskeys()
+        assert_equal(keys, sorted(keys, key=lambda k: k["left"]))
+
+        self.log.info("Spending the outputs moves them from txocount to usecount")
+        self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 1.5)
+        key = self.get_key(self.nodes[1], address)
+        assert_equal(key["txocount"], 0)
+        assert_greater_than(key["usecount"], 1)
+        self.sync_all()
+        self.nodes[0].generate(1)
+        self.sync_all()
+        assert_equal(self.get_key(self.nodes[1], address)["txocount"], 0)
+
+if __name__ == '__main__':
+    XMSSKeysTest().main()